@@ -0,0 +1,101 @@
+// get/set throughput of the paletted BlockStorage next to the old dense array layout
+#include "block_storage.h"
+#include "chunk.h"
+#include "noise.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using Dense = std::array<std::array<std::array<Block, CHUNK_SIZE>, CHUNK_HEIGHT>, CHUNK_SIZE>;
+
+static double nowSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// same column fill as Chunk::generate, without trees
+static int terrainHeight(int cx, int cz, int lx, int lz) {
+    float wx = static_cast<float>(cx * CHUNK_SIZE + lx);
+    float wz = static_cast<float>(cz * CHUNK_SIZE + lz);
+    float n = Noise::fbm2d(wx * 0.01f, wz * 0.01f, 5, 2.0f, 0.5f);
+    return 60 + static_cast<int>(n * 24);
+}
+
+static int storageIndex(int lx, int y, int lz) { return (y * CHUNK_SIZE + lz) * CHUNK_SIZE + lx; }
+
+static BlockType typeAt(int y, int height) {
+    if (y > height) return BlockType::AIR;
+    if (y == height) return BlockType::GRASS;
+    if (y > height - 3) return BlockType::DIRT;
+    return BlockType::STONE;
+}
+
+int main() {
+    const int chunks = 64;
+    const int volume = CHUNK_SIZE * CHUNK_HEIGHT * CHUNK_SIZE;
+    std::vector<std::array<int, CHUNK_SIZE * CHUNK_SIZE>> heights(chunks);
+    for (int c = 0; c < chunks; ++c)
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+            for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+                heights[c][lx * CHUNK_SIZE + lz] = terrainHeight(c % 8, c / 8, lx, lz);
+
+    std::vector<std::unique_ptr<Dense>> dense(chunks);
+    std::vector<std::unique_ptr<BlockStorage>> paletted(chunks);
+
+    double t0 = nowSeconds();
+    for (int c = 0; c < chunks; ++c) {
+        dense[c] = std::make_unique<Dense>();
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+            for (int y = 0; y < CHUNK_HEIGHT; ++y)
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+                    (*dense[c])[lx][y][lz] = {typeAt(y, heights[c][lx * CHUNK_SIZE + lz])};
+    }
+    double t1 = nowSeconds();
+    for (int c = 0; c < chunks; ++c) {
+        paletted[c] = std::make_unique<BlockStorage>(volume);
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+            for (int y = 0; y < CHUNK_HEIGHT; ++y)
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+                    paletted[c]->set(storageIndex(lx, y, lz), {typeAt(y, heights[c][lx * CHUNK_SIZE + lz])});
+    }
+    double t2 = nowSeconds();
+
+    // read back in the mesher's lx/lz/y order
+    const int rounds = 20;
+    uint64_t sumDense = 0, sumPaletted = 0;
+    double t3 = nowSeconds();
+    for (int r = 0; r < rounds; ++r)
+        for (int c = 0; c < chunks; ++c)
+            for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+                    for (int y = 0; y < CHUNK_HEIGHT; ++y)
+                        sumDense += static_cast<uint64_t>((*dense[c])[lx][y][lz].type);
+    double t4 = nowSeconds();
+    for (int r = 0; r < rounds; ++r)
+        for (int c = 0; c < chunks; ++c)
+            for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+                    for (int y = 0; y < CHUNK_HEIGHT; ++y)
+                        sumPaletted += static_cast<uint64_t>(paletted[c]->get(storageIndex(lx, y, lz)).type);
+    double t5 = nowSeconds();
+
+    size_t paletteBytes = 0;
+    int bitsHist[9] = {};
+    for (auto& p : paletted) { paletteBytes += p->memoryUsage() + sizeof(BlockStorage); bitsHist[p->bitsPerEntry()]++; }
+
+    const double sets = double(chunks) * volume;
+    const double gets = sets * rounds;
+    std::cout << "chunks: " << chunks << " (" << volume << " blocks each)\n";
+    std::cout << "set  dense:    " << sets / (t1 - t0) / 1e6 << " M/s\n";
+    std::cout << "set  paletted: " << sets / (t2 - t1) / 1e6 << " M/s\n";
+    std::cout << "get  dense:    " << gets / (t4 - t3) / 1e6 << " M/s\n";
+    std::cout << "get  paletted: " << gets / (t5 - t4) / 1e6 << " M/s\n";
+    std::cout << "memory dense:    " << chunks * sizeof(Dense) / 1024 << " KiB\n";
+    std::cout << "memory paletted: " << paletteBytes / 1024 << " KiB (bits/entry: 1=" << bitsHist[1]
+              << " 2=" << bitsHist[2] << " 4=" << bitsHist[4] << " 8=" << bitsHist[8] << ")\n";
+    if (sumDense != sumPaletted) { std::cerr << "checksum mismatch\n"; return 1; }
+    return 0;
+}
@@ -0,0 +1,97 @@
+// contention benchmark: N generator threads inserting chunks while one reader
+// thread does raycast-style lookups, ChunkMap vs the old unordered_map + single mutex
+#include "chunk_map.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// the previous World::chunks layout
+struct LockedMap {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, ChunkPtr> map;
+
+    ChunkPtr find(int cx, int cz) {
+        std::lock_guard<std::mutex> lk(mutex);
+        auto it = map.find(ChunkMap::key(cx, cz));
+        return it == map.end() ? nullptr : it->second;
+    }
+    bool reserve(int cx, int cz) {
+        std::lock_guard<std::mutex> lk(mutex);
+        return map.try_emplace(ChunkMap::key(cx, cz), nullptr).second;
+    }
+    void publish(int cx, int cz, ChunkPtr c) {
+        std::lock_guard<std::mutex> lk(mutex);
+        map[ChunkMap::key(cx, cz)] = std::move(c);
+    }
+};
+
+struct Result { double lookupsPerSec; double insertsPerSec; };
+
+template <typename Map>
+static Result run(Map& map, int generators, int radius) {
+    using clock = std::chrono::steady_clock;
+    std::atomic<bool> stop{false};
+    std::atomic<int> next{0};
+    const int side = radius * 2 + 1;
+    const int total = side * side;
+
+    // reader: walks short rays around the origin like Player::raycast does every frame
+    long long lookups = 0, hits = 0;
+    std::thread reader([&] {
+        uint32_t rng = 12345;
+        while (!stop.load(std::memory_order_relaxed)) {
+            rng = rng * 1664525u + 1013904223u;
+            int cx = static_cast<int>(rng % side) - radius;
+            int cz = static_cast<int>((rng >> 16) % side) - radius;
+            for (int step = 0; step < 50; ++step) {
+                ChunkPtr c = map.find(cx, cz);
+                hits += c != nullptr;
+                ++lookups;
+            }
+        }
+    });
+
+    auto t0 = clock::now();
+    std::vector<std::thread> gens;
+    for (int g = 0; g < generators; ++g) {
+        gens.emplace_back([&] {
+            for (int i = next.fetch_add(1); i < total; i = next.fetch_add(1)) {
+                int cx = i % side - radius, cz = i / side - radius;
+                if (!map.reserve(cx, cz)) continue;
+                auto c = std::make_shared<Chunk>(cx, cz);
+                // a little per-chunk work so the generators don't only hammer the map
+                for (int y = 0; y < 8; ++y) c->setBlockUnlocked(0, y, 0, {BlockType::STONE});
+                map.publish(cx, cz, std::move(c));
+            }
+        });
+    }
+    for (auto& t : gens) t.join();
+    double genSecs = std::chrono::duration<double>(clock::now() - t0).count();
+    stop = true;
+    reader.join();
+    double secs = std::chrono::duration<double>(clock::now() - t0).count();
+    if (hits > lookups) std::cerr << "impossible hit count\n";
+    return { lookups / secs, total / genSecs };
+}
+
+int main(int argc, char** argv) {
+    int generators = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const int radius = 150;
+    std::cout << "generators: " << generators << ", chunks: " << (2 * radius + 1) * (2 * radius + 1) << "\n";
+    {
+        LockedMap m;
+        Result r = run(m, generators, radius);
+        std::cout << "single mutex: " << r.lookupsPerSec / 1e6 << " M lookups/s, " << r.insertsPerSec / 1e3 << " K inserts/s\n";
+    }
+    {
+        ChunkMap m;
+        Result r = run(m, generators, radius);
+        std::cout << "sharded:      " << r.lookupsPerSec / 1e6 << " M lookups/s, " << r.insertsPerSec / 1e3 << " K inserts/s\n";
+    }
+    return 0;
+}
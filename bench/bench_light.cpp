@@ -0,0 +1,89 @@
+// light engine benchmark: relighting one edited block incrementally vs relighting
+// the chunks around it from scratch, over a 5x5 patch of generated terrain
+#include "light.h"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+int main() {
+    using clock = std::chrono::steady_clock;
+    auto msSince = [](clock::time_point t) { return std::chrono::duration<double, std::milli>(clock::now() - t).count(); };
+
+    const int N = 5, W = N * CHUNK_SIZE;
+    ChunkMap map;
+    LightEngine light(map);
+    std::vector<ChunkPtr> all;
+    for (int cz = 0; cz < N; ++cz) {
+        for (int cx = 0; cx < N; ++cx) {
+            auto c = std::make_shared<Chunk>(cx, cz);
+            c->generate();
+            LightEngine::lightChunk(*c);
+            map.publish(cx, cz, c);
+            light.queueBorders(cx, cz);
+            all.push_back(c);
+        }
+    }
+    light.process();
+
+    // evenly lit sections (open sky, buried rock) store no light
+    size_t stored = 0;
+    for (const ChunkPtr& c : all)
+        for (const SectionLightPtr& l : c->light) stored += l != nullptr;
+    double kib = double(stored) * sizeof(SectionLight) / 1024.0 / all.size();
+
+    // dig and refill around the surface: opens and closes overhangs and shafts
+    const int edits = 20000;
+    uint32_t rng = 12345;
+    double incrementalMs = 0.0;
+    for (int e = 0; e < edits; ++e) {
+        rng = rng * 1664525u + 1013904223u;
+        int wx = static_cast<int>(rng % W), wz = static_cast<int>((rng >> 12) % W);
+        ChunkPtr c = map.find(wx / CHUNK_SIZE, wz / CHUNK_SIZE);
+        int y = c->surfaceHeight(wx % CHUNK_SIZE, wz % CHUNK_SIZE) + 12 - static_cast<int>((rng >> 20) % 30);
+        if (y < 1 || y >= CHUNK_HEIGHT) continue;
+        c->setBlock(wx % CHUNK_SIZE, y, wz % CHUNK_SIZE, {(rng >> 28) % 3 == 0 ? BlockType::STONE : BlockType::AIR});
+        auto t0 = clock::now();
+        light.queueBlock(wx, y, wz, 0);
+        light.process();
+        incrementalMs += msSince(t0);
+    }
+
+    // the incremental updates must leave the light a from-scratch relight gives
+    std::vector<uint8_t> incremental;
+    for (const ChunkPtr& c : all)
+        for (int y = 0; y < CHUNK_HEIGHT; ++y)
+            for (int z = 0; z < CHUNK_SIZE; ++z)
+                for (int x = 0; x < CHUNK_SIZE; ++x) incremental.push_back(c->lightAt(x, y, z));
+    for (const ChunkPtr& c : all) LightEngine::lightChunk(*c);
+    for (const ChunkPtr& c : all) light.queueBorders(c->x, c->z);
+    light.process();
+    size_t i = 0;
+    for (const ChunkPtr& c : all)
+        for (int y = 0; y < CHUNK_HEIGHT; ++y)
+            for (int z = 0; z < CHUNK_SIZE; ++z)
+                for (int x = 0; x < CHUNK_SIZE; ++x, ++i)
+                    if (c->lightAt(x, y, z) != incremental[i]) {
+                        std::cerr << "incremental light differs from a full relight at " << c->x * CHUNK_SIZE + x
+                                  << "," << y << "," << c->z * CHUNK_SIZE + z << "\n";
+                        return 1;
+                    }
+
+    // what each edit would cost without the incremental path: the 3x3 chunks around it
+    auto t0 = clock::now();
+    const int fullRuns = 20;
+    for (int r = 0; r < fullRuns; ++r) {
+        for (int cz = 1; cz <= 3; ++cz)
+            for (int cx = 1; cx <= 3; ++cx) LightEngine::lightChunk(*map.find(cx, cz));
+        for (int cz = 1; cz <= 3; ++cz)
+            for (int cx = 1; cx <= 3; ++cx) light.queueBorders(cx, cz);
+        light.process();
+    }
+    double fullMs = msSince(t0) / fullRuns;
+
+    std::cout << "incremental: " << incrementalMs / edits * 1000.0 << " us/edit\n";
+    std::cout << "full 3x3   : " << fullMs << " ms/edit (" << fullMs / 9.0 << " ms/chunk)\n";
+    std::cout << "ratio      : " << fullMs / (incrementalMs / edits) << "x\n";
+    std::cout << "storage    : " << kib << " KiB/chunk lit (dense: " << CHUNK_VOLUME / 1024 << " KiB)\n";
+    return 0;
+}
@@ -0,0 +1,100 @@
+// chunk mesh vertex formats on the same scene: the packed 8-byte PackedVertex vs
+// the previous 13-float layout (pos, tex, light, rgb, typeId, worldY, overlay, tile).
+// No GL context: "upload" is the copy into a staging buffer the driver would do.
+#include "mesh.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// re-expand a packed vertex into the old float layout, exactly as voxel.vert decodes it
+static void pushLegacy(std::vector<float>& out, const PackedVertex& v, int ox, int oz, const float* materials) {
+    static const int AXES[6][2] = {{2, 1}, {2, 1}, {0, 1}, {0, 1}, {0, 2}, {0, 2}};
+    static const float FLIP[6][2] = {{1, 1}, {-1, 1}, {-1, 1}, {1, 1}, {1, 1}, {1, -1}};
+    float p[3] = {float(v.lo & 31u), float((v.lo >> 5) & 255u), float((v.lo >> 13) & 31u)};
+    int face = (v.lo >> 18) & 7u;
+    const float* m = &materials[((v.hi >> 16) & 255u) * 4];
+    float vals[13] = {
+        p[0] + ox, p[1], p[2] + oz,
+        p[AXES[face][0]] * FLIP[face][0], p[AXES[face][1]] * FLIP[face][1],
+        float((v.lo >> 21) & 15u) / 15.0f,
+        m[0], m[1], m[2], m[3],
+        float(v.hi >> 24), float((v.hi >> 8) & 255u) - 1.0f, float(v.hi & 255u),
+    };
+    out.insert(out.end(), vals, vals + 13);
+}
+
+int main() {
+    using clock = std::chrono::steady_clock;
+    const int side = 12;
+    std::vector<std::unique_ptr<Chunk>> scene;
+    for (int i = 0; i < side * side; ++i) {
+        scene.push_back(std::make_unique<Chunk>(i % side, i / side));
+        scene.back()->generate();
+    }
+    // chunks on the edge of the scene have missing neighbours, like the edge of the loaded area
+    auto neighborsOf = [&](const Chunk& c) {
+        auto at = [&](int x, int z) -> const Chunk* {
+            return (x < 0 || x >= side || z < 0 || z >= side) ? nullptr : scene[z * side + x].get();
+        };
+        return Mesh::Neighbors{at(c.x - 1, c.z), at(c.x + 1, c.z), at(c.x, c.z - 1), at(c.x, c.z + 1)};
+    };
+    auto materials = Mesh::materialPalette(nullptr);
+    std::cout << "scene: " << scene.size() << " generated chunks\n";
+
+    for (MeshMode mode : {MeshMode::NAIVE, MeshMode::GREEDY, MeshMode::BINARY}) {
+        const char* name = mode == MeshMode::NAIVE ? "naive " : mode == MeshMode::GREEDY ? "greedy" : "binary";
+        std::vector<PackedVertex> packed;
+        std::vector<float> legacy;
+        std::vector<unsigned char> staging;
+        size_t verts = 0, packedBytes = 0, legacyBytes = 0;
+        double packedMs = 0.0, legacyMs = 0.0;
+        const int reps = 5;
+        for (int r = 0; r < reps; ++r) {
+            for (auto& c : scene) {
+                auto t0 = clock::now();
+                Mesh::buildVertices(c.get(), neighborsOf(*c), nullptr, mode, packed);
+                staging.resize(packed.size() * sizeof(PackedVertex));
+                std::memcpy(staging.data(), packed.data(), staging.size());
+                auto t1 = clock::now();
+                legacy.clear();
+                for (const PackedVertex& v : packed)
+                    pushLegacy(legacy, v, c->x * CHUNK_SIZE, c->z * CHUNK_SIZE, materials.data());
+                staging.resize(legacy.size() * sizeof(float));
+                std::memcpy(staging.data(), legacy.data(), staging.size());
+                auto t2 = clock::now();
+                packedMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+                // the float path pays for the same mesh walk plus the wider encoding
+                legacyMs += std::chrono::duration<double, std::milli>(t2 - t0).count();
+                if (r == 0) {
+                    verts += packed.size();
+                    packedBytes += packed.size() * sizeof(PackedVertex);
+                    legacyBytes += legacy.size() * sizeof(float);
+                }
+            }
+        }
+        double n = double(scene.size());
+        std::cout << name << ": " << verts / n << " vertices/chunk\n"
+                  << "  packed  " << packedBytes / n / 1024.0 << " KiB/chunk, " << packedMs / (n * reps) << " ms/chunk\n"
+                  << "  float   " << legacyBytes / n / 1024.0 << " KiB/chunk, " << legacyMs / (n * reps) << " ms/chunk\n"
+                  << "  ratio   " << double(legacyBytes) / double(packedBytes) << "x smaller\n";
+    }
+
+    // levels of detail: the whole scene at one level, so every coarse border is
+    // skirted against a coarse neighbour (and closed at the edge of the scene)
+    for (int lod = 0; lod <= Mesh::MAX_LOD; ++lod) {
+        size_t verts[2] = {};
+        SectionVertices out;
+        for (auto& c : scene) {
+            for (int m = 0; m < 2; ++m) {
+                Mesh::buildSections(c.get(), neighborsOf(*c), nullptr, m ? MeshMode::GREEDY : MeshMode::NAIVE, 0xFF,
+                                    out, nullptr, lod);
+                for (const auto& v : out) verts[m] += v.size();
+            }
+        }
+        double n = double(scene.size());
+        std::cout << "lod " << lod << ": naive " << verts[0] / n << ", greedy " << verts[1] / n << " vertices/chunk\n";
+    }
+    return 0;
+}
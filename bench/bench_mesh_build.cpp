@@ -0,0 +1,105 @@
+// CPU mesh build throughput: full-chunk builds (vertices/s) and single-section
+// rebuilds after a block edit, for every mesher on the same generated scene
+#include "mesh.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+int main() {
+    using clock = std::chrono::steady_clock;
+    const int side = 8;
+    std::vector<std::unique_ptr<Chunk>> scene;
+    for (int i = 0; i < side * side; ++i) {
+        scene.push_back(std::make_unique<Chunk>(i % side, i / side));
+        scene.back()->generate();
+    }
+    auto neighborsOf = [&](const Chunk& c) {
+        auto at = [&](int x, int z) -> const Chunk* {
+            return (x < 0 || x >= side || z < 0 || z >= side) ? nullptr : scene[z * side + x].get();
+        };
+        return Mesh::Neighbors{at(c.x - 1, c.z), at(c.x + 1, c.z), at(c.x, c.z - 1), at(c.x, c.z + 1)};
+    };
+
+    // the bitmask mesher must reproduce the greedy one exactly
+    for (auto& c : scene) {
+        SectionVertices greedy, binary;
+        SectionQuadCounts greedyCut, binaryCut;
+        Mesh::buildSections(c.get(), neighborsOf(*c), nullptr, MeshMode::GREEDY, 0xFF, greedy, nullptr, 0, &greedyCut);
+        Mesh::buildSections(c.get(), neighborsOf(*c), nullptr, MeshMode::BINARY, 0xFF, binary, nullptr, 0, &binaryCut);
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            bool same = greedy[si].size() == binary[si].size() && greedyCut[si] == binaryCut[si];
+            for (size_t i = 0; same && i < greedy[si].size(); ++i)
+                same = greedy[si][i].lo == binary[si][i].lo && greedy[si][i].hi == binary[si][i].hi;
+            if (!same) {
+                std::cerr << "binary mesh differs from greedy in chunk " << c->x << "," << c->z << " section " << si << "\n";
+                return 1;
+            }
+        }
+    }
+
+    // merging must cover the same unit faces the naive mesher emits: each quad is
+    // split into its blocks, keyed by position, face, light, tile and material
+    // (not the snow-blend height, which a merged side face takes from its bottom)
+    auto unitFaces = [](const SectionVertices& sections) {
+        std::vector<uint64_t> faces;
+        for (const auto& verts : sections) {
+            for (size_t q = 0; q + 3 < verts.size(); q += 4) {
+                const PackedVertex& a = verts[q];
+                const PackedVertex& b = verts[q + 2]; // corner opposite a
+                int lo[3] = {int(a.lo & 31), int(a.lo >> 5 & 255), int(a.lo >> 13 & 31)};
+                int hi[3] = {int(b.lo & 31), int(b.lo >> 5 & 255), int(b.lo >> 13 & 31)};
+                for (int k = 0; k < 3; ++k)
+                    if (hi[k] == lo[k]) ++hi[k]; // the face's own axis
+                uint64_t rest = (a.lo & ~0x3FFFFu) | uint64_t(a.hi & 0xFFFFFFu) << 32;
+                for (int y = lo[1]; y < hi[1]; ++y)
+                    for (int z = lo[2]; z < hi[2]; ++z)
+                        for (int x = lo[0]; x < hi[0]; ++x)
+                            faces.push_back(rest | uint32_t(x) | uint32_t(y) << 5 | uint32_t(z) << 13);
+            }
+        }
+        std::sort(faces.begin(), faces.end());
+        return faces;
+    };
+    for (auto& c : scene) {
+        SectionVertices naive, greedy;
+        Mesh::buildSections(c.get(), neighborsOf(*c), nullptr, MeshMode::NAIVE, 0xFF, naive);
+        Mesh::buildSections(c.get(), neighborsOf(*c), nullptr, MeshMode::GREEDY, 0xFF, greedy);
+        if (unitFaces(naive) != unitFaces(greedy)) {
+            std::cerr << "greedy mesh covers other faces than naive in chunk " << c->x << "," << c->z << "\n";
+            return 1;
+        }
+    }
+
+    for (MeshMode mode : {MeshMode::NAIVE, MeshMode::GREEDY, MeshMode::BINARY}) {
+        const char* name = mode == MeshMode::NAIVE ? "naive " : mode == MeshMode::GREEDY ? "greedy" : "binary";
+        // full builds, each into a fresh result like a mesh job hands over
+        size_t verts = 0;
+        const int reps = 10;
+        auto t0 = clock::now();
+        for (int r = 0; r < reps; ++r) {
+            for (auto& c : scene) {
+                SectionVertices out;
+                Mesh::buildSections(c.get(), neighborsOf(*c), nullptr, mode, 0xFF, out);
+                for (const auto& v : out) verts += v.size();
+            }
+        }
+        double secs = std::chrono::duration<double>(clock::now() - t0).count();
+
+        // one section rebuilt into a kept cache, as after a single block edit
+        SectionVertices cache;
+        Chunk& c = *scene[side * side / 2 + side / 2];
+        Mesh::buildSections(&c, neighborsOf(c), nullptr, mode, 0xFF, cache);
+        const int edits = 2000;
+        auto t1 = clock::now();
+        for (int i = 0; i < edits; ++i)
+            Mesh::buildSections(&c, neighborsOf(c), nullptr, mode, static_cast<uint8_t>(1u << (3 + i % 3)), cache);
+        double editUs = std::chrono::duration<double, std::micro>(clock::now() - t1).count() / edits;
+
+        std::cout << name << ": " << verts / secs / 1e6 << " M vertices/s, "
+                  << secs * 1e3 / (reps * scene.size()) << " ms/chunk, "
+                  << editUs << " us/section rebuild\n";
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+// batched (SIMD) noise against the scalar path: bitwise comparison and throughput
+#include "noise.h"
+#include "chunk.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static double nowSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main() {
+    // the sample grids Chunk::generate feeds in, for a 32x32 chunk area around the origin
+    const int chunksPerSide = 32;
+    const int columns = CHUNK_SIZE * CHUNK_SIZE;
+    const int n = chunksPerSide * chunksPerSide * columns;
+    std::vector<float> xs(n), ys(n);
+    for (int c = 0; c < chunksPerSide * chunksPerSide; ++c) {
+        int cx = c % chunksPerSide - chunksPerSide / 2, cz = c / chunksPerSide - chunksPerSide / 2;
+        for (int i = 0; i < columns; ++i) {
+            xs[c * columns + i] = static_cast<float>(cx * CHUNK_SIZE + i / CHUNK_SIZE) * 0.01f;
+            ys[c * columns + i] = static_cast<float>(cz * CHUNK_SIZE + i % CHUNK_SIZE) * 0.01f;
+        }
+    }
+    Noise::gradientTable(); // build the table outside the timed region
+
+    std::vector<float> scalarOut(n), batchOut(n);
+    double t0 = nowSeconds();
+    for (int i = 0; i < n; ++i) scalarOut[i] = Noise::fbm2d(xs[i], ys[i], 5, 2.0f, 0.5f);
+    double t1 = nowSeconds();
+    for (int c = 0; c < n; c += columns)
+        Noise::fbm2dBatch(xs.data() + c, ys.data() + c, batchOut.data() + c, columns, 5, 2.0f, 0.5f);
+    double t2 = nowSeconds();
+
+    int mismatches = 0;
+    float maxDiff = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        if (std::memcmp(&scalarOut[i], &batchOut[i], sizeof(float)) != 0) ++mismatches;
+        maxDiff = std::max(maxDiff, std::fabs(scalarOut[i] - batchOut[i]));
+    }
+
+    // perlin2d on its own, over coordinates that cross zero and cell borders
+    std::vector<float> px(n), py(n), ps(n), pb(n);
+    for (int i = 0; i < n; ++i) { px[i] = (i % 977) * 0.173f - 80.0f; py[i] = (i / 977) * 0.291f - 30.0f; }
+    double t3 = nowSeconds();
+    for (int i = 0; i < n; ++i) ps[i] = Noise::perlin2d(px[i], py[i]);
+    double t4 = nowSeconds();
+    Noise::perlin2dBatch(px.data(), py.data(), pb.data(), n);
+    double t5 = nowSeconds();
+    int perlinMismatches = 0;
+    for (int i = 0; i < n; ++i)
+        if (std::memcmp(&ps[i], &pb[i], sizeof(float)) != 0) ++perlinMismatches;
+
+    std::cout << "samples: " << n << " (" << chunksPerSide * chunksPerSide << " chunk grids)\n";
+    std::cout << "fbm2d  scalar: " << n / (t1 - t0) / 1e6 << " M samples/s\n";
+    std::cout << "fbm2d  batch:  " << n / (t2 - t1) / 1e6 << " M samples/s\n";
+    std::cout << "perlin scalar: " << n / (t4 - t3) / 1e6 << " M samples/s\n";
+    std::cout << "perlin batch:  " << n / (t5 - t4) / 1e6 << " M samples/s\n";
+    std::cout << "fbm mismatches: " << mismatches << " (max abs diff " << maxDiff << "), perlin mismatches: " << perlinMismatches << "\n";
+    return (mismatches == 0 && perlinMismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// region storage: chunk save and load throughput through the mmap'd region files,
+// over edited generated terrain
+#include "region.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+int main() {
+    using clock = std::chrono::steady_clock;
+    auto msSince = [](clock::time_point t) { return std::chrono::duration<double, std::milli>(clock::now() - t).count(); };
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "cubica_bench_region";
+    std::filesystem::remove_all(dir);
+
+    const int side = 8;
+    std::vector<std::unique_ptr<Chunk>> scene;
+    uint32_t rng = 12345;
+    for (int i = 0; i < side * side; ++i) {
+        scene.push_back(std::make_unique<Chunk>(i % side, i / side));
+        Chunk& c = *scene.back();
+        c.generate();
+        // dig and place around the surface so records hold more than generated terrain
+        for (int e = 0; e < 200; ++e) {
+            rng = rng * 1664525u + 1013904223u;
+            int x = static_cast<int>(rng % CHUNK_SIZE), z = static_cast<int>((rng >> 8) % CHUNK_SIZE);
+            int y = c.surfaceHeight(x, z) + 8 - static_cast<int>((rng >> 16) % 24);
+            if (y < 1 || y >= CHUNK_HEIGHT) continue;
+            c.setBlock(x, y, z, {static_cast<BlockType>((rng >> 24) % 6)});
+        }
+    }
+
+    double saveMs = 0.0, loadMs = 0.0;
+    const int reps = 10;
+    {
+        RegionStore store(dir.string());
+
+        // a load must give back exactly what was saved, counts included
+        for (auto& c : scene) {
+            if (!store.save(*c)) {
+                std::cerr << "save failed for chunk " << c->x << "," << c->z << "\n";
+                return 1;
+            }
+            Chunk back(c->x, c->z);
+            bool same = store.load(back);
+            for (int si = 0; same && si < SECTION_COUNT; ++si) {
+                const ChunkSection* a = c->sections[si].get();
+                const ChunkSection* b = back.sections[si].get();
+                same = (a == nullptr) == (b == nullptr) && c->sectionFill[si] == back.sectionFill[si];
+                if (same && a) same = a->solidCount == b->solidCount && a->opaqueCount == b->opaqueCount;
+            }
+            for (int y = 0; same && y < CHUNK_HEIGHT; ++y)
+                for (int z = 0; same && z < CHUNK_SIZE; ++z)
+                    for (int x = 0; same && x < CHUNK_SIZE; ++x)
+                        same = c->getBlock(x, y, z).type == back.getBlock(x, y, z).type;
+            if (!same) {
+                std::cerr << "chunk " << c->x << "," << c->z << " differs after a save/load round trip\n";
+                return 1;
+            }
+        }
+
+        auto t0 = clock::now();
+        for (int r = 0; r < reps; ++r)
+            for (auto& c : scene) store.save(*c);
+        saveMs = msSince(t0) / (reps * scene.size());
+
+        auto t1 = clock::now();
+        for (int r = 0; r < reps; ++r) {
+            for (auto& c : scene) {
+                Chunk back(c->x, c->z);
+                store.load(back);
+            }
+        }
+        loadMs = msSince(t1) / (reps * scene.size());
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << "save: " << saveMs * 1000.0 << " us/chunk\n";
+    std::cout << "load: " << loadMs * 1000.0 << " us/chunk\n";
+    return 0;
+}
@@ -1,30 +1,54 @@
 #version 330 core
 
-in vec2      TexCoord;
-in float     Light;       // vertex light / ao / etc. [0..1]
+in vec2      TexCoord;    // block units across the quad (merged quads span several blocks)
+in float     SkyLight;    // flood-filled sky light in front of the face [0..1]
+in float     BlockLight;  // flood-filled block light in front of the face [0..1]
+in vec3      Normal;      // face normal
 in vec3      Color;       // per-vertex tint / biome color
 in float     TypeId;      // 0 = terrain (grass/dirt), 3 = ? (leaves, etc.)
 in float     WorldY;      // world-space height
 in float     OverlayTile; // -1 = no overlay, otherwise atlas column index
+in float     Tile;        // atlas column index of the base texture
 
 out vec4     FragColor;
 
+// same block as voxel.vert
+layout(std140) uniform Frame {
+    mat4  projection;
+    mat4  view;
+    float snowLine;
+    float snowBlendRange;
+};
+
 uniform sampler2D atlas;
 uniform int       atlasTiles     = 1;          // number of horizontal tiles in atlas
 uniform vec3      lightDir       = normalize(vec3(0.5, 1.0, 0.3));
-uniform float     snowLine       = 80.0;
-uniform float     snowBlendRange = 8.0;
 uniform float     ambient        = 0.28;       // ← made tunable
+uniform float     daylight       = 1.0;        // scales sky light (1 = noon)
+uniform float     minLight       = 0.04;       // keeps unlit caves from going fully black
 
 // Helpers
 const vec3 SNOW_COLOR    = vec3(0.96, 0.97, 0.98);
 const vec3 GRASS_TINT    = vec3(0.22, 0.92, 0.18); // slightly more natural green
-const float EPSILON      = 0.001;
+
+// light level [0..1] to brightness: 0.8x per level below full, black at level 0
+float lightCurve(float level)
+{
+    return level > 0.0 ? pow(0.8, 15.0 * (1.0 - level)) : 0.0;
+}
 
 void main()
 {
     // ── Base texture ───────────────────────────────────────
-    vec3 baseColor = texture(atlas, TexCoord).rgb;
+    // repeat the tile once per block across merged quads
+    float tileWidth = 1.0 / float(max(atlasTiles, 1));
+    vec2  localUV   = fract(TexCoord);
+    vec4 base      = texture(atlas, vec2((Tile + localUV.x) * tileWidth, localUV.y));
+#ifdef CUTOUT
+    // leaves pass: alpha-tested; the opaque pass has no discard and keeps early-Z
+    if (base.a < 0.5) discard;
+#endif
+    vec3 baseColor = base.rgb;
 
     // ── Snow blending (only for terrain) ───────────────────
     float snowFactor = 0.0;
@@ -37,12 +61,13 @@ void main()
     }
 
     // ── Lighting ───────────────────────────────────────────
-    vec3  normal     = vec3(0.0, 1.0, 0.0);           // we fake top-down lighting
-    float NdotL      = max(dot(normal, lightDir), 0.0);
+    // sun shading only reaches what the sky lights; block light is undirected
+    float NdotL        = max(dot(normalize(Normal), lightDir), 0.0);
     float illumination = ambient + (1.0 - ambient) * NdotL;
+    float sky          = lightCurve(SkyLight) * daylight * illumination;
+    float block        = lightCurve(BlockLight);
 
-    vec3 litColor = baseColor * (Light * 0.4 + illumination * 0.6);
-    //                 ^^^ tweak these weights to taste
+    vec3 litColor = baseColor * max(max(sky, block), minLight);
 
     // ── Biome / type specific tints ────────────────────────
     if (TypeId == 0.0)        // terrain
@@ -60,11 +85,7 @@ void main()
     // ── Optional overlay (foliage, moss, snow layer, etc.) ─
     if (OverlayTile >= 0.0 && atlasTiles > 0)
     {
-        float tileWidth  = 1.0 / float(atlasTiles);
-        float tileIndex  = floor(TexCoord.x / tileWidth + EPSILON);
-        float localU     = TexCoord.x - tileIndex * tileWidth;
-
-        vec2 overlayUV   = vec2(OverlayTile * tileWidth + localU, TexCoord.y);
+        vec2 overlayUV   = vec2((OverlayTile + localUV.x) * tileWidth, localUV.y);
         vec4 overlay     = texture(atlas, overlayUV);
 
         // Classic alpha blending – works well for leaves, details, damage decals…
@@ -1,29 +1,54 @@
 #version 330 core
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec2 aTexCoord;
-layout(location = 2) in float aLight;
-layout(location = 3) in vec3 aColor;
-layout(location = 4) in float aType;
-layout(location = 5) in float aWorldY;
-layout(location = 6) in float aOverlay;
+// packed chunk vertex (see PackedVertex in mesh.h):
+//   x: x 5 | y 8 | z 5 | face 3 | block light 4 | sky light 4
+//   y: tile 8 | overlay+1 8 | material 8 | worldY 8
+layout(location = 0) in uvec2 aPacked;
+// world position of the chunk's corner, one per draw command (see MeshArena)
+layout(location = 1) in vec3 aChunkOrigin;
 
 out vec2 TexCoord;
-out float Light;
+out float SkyLight;
+out float BlockLight;
+out vec3 Normal;
 out vec3 Color;
 out float TypeId;
 out float WorldY;
 out float OverlayTile;
+out float Tile;
+
+// per-frame camera data, one buffer shared by every voxel program (FrameUniforms in shader.h)
+layout(std140) uniform Frame {
+    mat4  projection;
+    mat4  view;
+    float snowLine;
+    float snowBlendRange;
+};
 
-uniform mat4 projection;
-uniform mat4 view;
 uniform mat4 model;
+uniform vec4 materials[32];   // rgb tint + type id, see Mesh::materialPalette
+
+// per face (-X, +X, -Z, +Z, bottom, top): the axes a quad spans and the
+// direction its texture runs along them (matches FACE_DIRS in mesh.cpp)
+const ivec2 FACE_AXES[6] = ivec2[6](ivec2(2, 1), ivec2(2, 1), ivec2(0, 1), ivec2(0, 1), ivec2(0, 2), ivec2(0, 2));
+const vec2  FACE_FLIP[6] = vec2[6](vec2(1, 1), vec2(-1, 1), vec2(-1, 1), vec2(1, 1), vec2(1, 1), vec2(1, -1));
+const vec3  FACE_NORMAL[6] = vec3[6](vec3(-1, 0, 0), vec3(1, 0, 0), vec3(0, 0, -1), vec3(0, 0, 1), vec3(0, -1, 0), vec3(0, 1, 0));
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    TexCoord = aTexCoord;
-    Light = aLight;
-    Color = aColor;
-    TypeId = aType;
-    WorldY = aWorldY;
-    OverlayTile = aOverlay;
+    uint lo = aPacked.x;
+    uint hi = aPacked.y;
+    vec3 local = vec3(float(lo & 31u), float((lo >> 5) & 255u), float((lo >> 13) & 31u));
+    int face = int((lo >> 18) & 7u);
+    vec4 material = materials[(hi >> 16) & 255u];
+
+    gl_Position = projection * view * model * vec4(aChunkOrigin + local, 1.0);
+    // block units along the face; the fragment shader wraps them per block
+    TexCoord = vec2(local[FACE_AXES[face].x], local[FACE_AXES[face].y]) * FACE_FLIP[face];
+    BlockLight = float((lo >> 21) & 15u) / 15.0;
+    SkyLight = float((lo >> 25) & 15u) / 15.0;
+    Normal = mat3(model) * FACE_NORMAL[face];
+    Color = material.rgb;
+    TypeId = material.a;
+    WorldY = float(hi >> 24);
+    OverlayTile = float((hi >> 8) & 255u) - 1.0;
+    Tile = float(hi & 255u);
 }
@@ -16,4 +16,15 @@ struct Block {
     bool isSolid() const {
         return type != BlockType::AIR;
     }
+
+    // light spreads through air and through leaves, which are drawn alpha-tested
+    // and show the faces behind them
+    bool passesLight() const {
+        return type == BlockType::AIR || type == BlockType::LEAVES;
+    }
+
+    // block light level (0..15) the block gives off; none of the current blocks glow
+    uint8_t lightEmission() const {
+        return 0;
+    }
 };
\ No newline at end of file
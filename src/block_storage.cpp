@@ -0,0 +1,117 @@
+#include "block_storage.h"
+#include <algorithm>
+
+BlockStorage::BlockStorage(int volume, Block fill) : volume(volume) {
+    palette.push_back(fill);
+}
+
+int BlockStorage::paletteIndexOf(Block block) const {
+    for (size_t i = 0; i < palette.size(); ++i)
+        if (palette[i].type == block.type) return static_cast<int>(i);
+    return -1;
+}
+
+void BlockStorage::resize(int newBits) {
+    // re-pack every entry at the new width in place; old indices stay valid.
+    // Entries move to equal or higher bit offsets, so walking from the last
+    // entry down never overwrites one that has not been read yet.
+    int perWord = 64 / newBits;
+    int newShift = 0;
+    while ((1 << newShift) < perWord) ++newShift;
+    size_t newWords = (volume + perWord - 1) / perWord;
+    if (bits == 0) {
+        words.assign(newWords, 0); // reuses capacity left by a recycled storage
+    } else {
+        words.resize(newWords, 0);
+        uint64_t newMask = (uint64_t(1) << newBits) - 1;
+        for (int i = volume - 1; i >= 0; --i) {
+            uint64_t v = (words[i >> entriesShift] >> ((i & entriesMask) * bits)) & valueMask;
+            uint64_t& w = words[i >> newShift];
+            int shift = (i & (perWord - 1)) * newBits;
+            w = (w & ~(newMask << shift)) | (v << shift);
+        }
+    }
+    bits = newBits;
+    entriesShift = newShift;
+    entriesMask = perWord - 1;
+    valueMask = (uint64_t(1) << newBits) - 1;
+}
+
+void BlockStorage::set(int index, Block block) {
+    int idx = paletteIndexOf(block);
+    if (idx < 0) {
+        idx = static_cast<int>(palette.size());
+        palette.push_back(block);
+        // widen indices when the palette outgrows the current width
+        int needed = bits == 0 ? 1 : bits;
+        while ((1 << needed) < static_cast<int>(palette.size())) needed *= 2;
+        if (needed != bits) resize(needed);
+    }
+    if (bits == 0) return; // single-entry palette and block already matches
+    uint64_t& w = words[index >> entriesShift];
+    int shift = (index & entriesMask) * bits;
+    w = (w & ~(valueMask << shift)) | (static_cast<uint64_t>(idx) << shift);
+}
+
+void BlockStorage::getAll(Block* out) const {
+    if (bits == 0) {
+        std::fill(out, out + volume, palette[0]);
+        return;
+    }
+    int perWord = entriesMask + 1;
+    int i = 0;
+    for (uint64_t word : words) {
+        for (int k = 0; k < perWord && i < volume; ++k, ++i) {
+            out[i] = palette[word & valueMask];
+            word >>= bits;
+        }
+    }
+}
+
+void BlockStorage::countUses(int* uses) const {
+    std::fill(uses, uses + palette.size(), 0);
+    if (bits == 0) {
+        uses[0] = volume;
+        return;
+    }
+    int perWord = entriesMask + 1;
+    int i = 0;
+    for (uint64_t word : words) {
+        for (int k = 0; k < perWord && i < volume; ++k, ++i) {
+            ++uses[word & valueMask];
+            word >>= bits;
+        }
+    }
+}
+
+void BlockStorage::fill(Block block) {
+    palette.assign(1, block);
+    words.clear(); // keep capacity so a recycled storage can widen without allocating
+    bits = 0;
+    entriesShift = 0;
+    entriesMask = 0;
+    valueMask = 0;
+}
+
+size_t BlockStorage::memoryUsage() const {
+    return palette.capacity() * sizeof(Block) + words.capacity() * sizeof(uint64_t);
+}
+
+void BlockStorage::assign(const Block* newPalette, int paletteSize, int newBits, const uint64_t* newWords) {
+    palette.assign(newPalette, newPalette + paletteSize);
+    if (palette.empty()) palette.push_back(Block{});
+    words.clear();
+    bits = 0;
+    entriesShift = 0;
+    entriesMask = 0;
+    valueMask = 0;
+    if (newBits == 0) return;
+    int perWord = 64 / newBits;
+    int shift = 0;
+    while ((1 << shift) < perWord) ++shift;
+    words.assign(newWords, newWords + wordCountFor(volume, newBits));
+    bits = newBits;
+    entriesShift = shift;
+    entriesMask = perWord - 1;
+    valueMask = (uint64_t(1) << newBits) - 1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "block.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Paletted, bit-packed block container.
+// Every entry is an index into a small palette of distinct blocks. Indices are
+// 0, 1, 2, 4 or 8 bits wide and widen when a new block type shows up; a
+// storage holding a single type (e.g. all air) keeps no index words at all.
+// Widths are powers of two so an entry never straddles a 64-bit word.
+class BlockStorage {
+public:
+    explicit BlockStorage(int volume, Block fill = {});
+
+    Block get(int index) const {
+        if (bits == 0) return palette[0];
+        uint64_t w = words[index >> entriesShift];
+        int shift = (index & entriesMask) * bits;
+        return palette[(w >> shift) & valueMask];
+    }
+
+    void set(int index, Block block);
+
+    // decode every entry into out[0..size()) in one pass over the index words
+    void getAll(Block* out) const;
+    // how many entries use each palette slot, into uses[0..getPalette().size())
+    void countUses(int* uses) const;
+
+    // reset every entry to a single block (drops the index words)
+    void fill(Block block);
+
+    int size() const { return volume; }
+    int bitsPerEntry() const { return bits; }
+    const std::vector<Block>& getPalette() const { return palette; }
+
+    // bytes held by the palette and index words (excluding the object itself)
+    size_t memoryUsage() const;
+
+    // raw packed form, used to write and read region files
+    const std::vector<uint64_t>& getWords() const { return words; }
+    static size_t wordCountFor(int volume, int bits) { return bits ? (volume + 64 / bits - 1) / (64 / bits) : 0; }
+    // replace the contents with an already packed palette + index words
+    void assign(const Block* newPalette, int paletteSize, int newBits, const uint64_t* newWords);
+
+private:
+    int volume;
+    int bits = 0;
+    int entriesShift = 0;   // log2(entries per word)
+    int entriesMask = 0;    // entries per word - 1
+    uint64_t valueMask = 0;
+    std::vector<Block> palette;
+    std::vector<uint64_t> words;
+
+    int paletteIndexOf(Block block) const;
+    void resize(int newBits);
+};
@@ -1,13 +1,53 @@
 #include "chunk.h"
 #include <cmath>
+#include <mutex>
 #include "noise.h"
 #include "mesh.h"
 
-Chunk::Chunk(int cx, int cz) : x(cx), z(cz) {
-    for (int i = 0; i < CHUNK_SIZE; i++)
-        for (int j = 0; j < CHUNK_HEIGHT; j++)
-            for (int k = 0; k < CHUNK_SIZE; k++)
-                blocks[i][j][k] = {BlockType::AIR};
+ObjectPool<ChunkSection>& ChunkSection::pool() {
+    static ObjectPool<ChunkSection> p(1024);
+    return p;
+}
+
+void ChunkSection::Recycle::operator()(ChunkSection* s) const {
+    s->blocks.fill({BlockType::AIR});
+    s->solidCount = 0;
+    s->opaqueCount = 0;
+    pool().release(s);
+}
+
+SectionPtr ChunkSection::acquire() {
+    return SectionPtr(pool().acquire());
+}
+
+void ChunkSection::recount() {
+    // tally the palette slots once, then count the blocks they stand for
+    int uses[256];
+    blocks.countUses(uses);
+    const std::vector<Block>& palette = blocks.getPalette();
+    solidCount = 0;
+    opaqueCount = 0;
+    for (size_t i = 0; i < palette.size(); ++i) {
+        if (palette[i].isSolid()) solidCount += uses[i];
+        if (!palette[i].passesLight()) opaqueCount += uses[i];
+    }
+}
+
+ObjectPool<SectionLight>& SectionLight::pool() {
+    static ObjectPool<SectionLight> p(1024);
+    return p;
+}
+
+void SectionLight::Recycle::operator()(SectionLight* l) const {
+    pool().release(l);
+}
+
+SectionLightPtr SectionLight::acquire() {
+    return SectionLightPtr(pool().acquire());
+}
+
+Chunk::Chunk(int cx, int cz) : x(cx), z(cz), meshCache(std::make_unique<SectionMeshCache>()) {
+    heightmap.fill(-1);
 }
 
 void Chunk::generate() {
@@ -15,37 +55,52 @@ void Chunk::generate() {
     const int baseHeight = 60;
     const int amplitude = 24;
 
+    // evaluate the height and tree noise for the whole 16x16 grid in batches
+    constexpr int COLUMNS = CHUNK_SIZE * CHUNK_SIZE;
+    float hx[COLUMNS], hz[COLUMNS], tx[COLUMNS], tz[COLUMNS];
+    float heightNoise[COLUMNS], treeNoiseGrid[COLUMNS];
     for (int lx = 0; lx < CHUNK_SIZE; lx++) {
         for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+            int i = lx * CHUNK_SIZE + lz;
             float wx = static_cast<float>(x * CHUNK_SIZE + lx);
             float wz = static_cast<float>(z * CHUNK_SIZE + lz);
-            float n = Noise::fbm2d(wx * scale, wz * scale, 5, 2.0f, 0.5f); // in approx [-1,1]
+            hx[i] = wx * scale; hz[i] = wz * scale;
+            tx[i] = wx * 0.05f; tz[i] = wz * 0.05f;
+        }
+    }
+    Noise::fbm2dBatch(hx, hz, heightNoise, COLUMNS, 5, 2.0f, 0.5f); // in approx [-1,1]
+    Noise::perlin2dBatch(tx, tz, treeNoiseGrid, COLUMNS);
+
+    std::unique_lock<std::shared_mutex> lk(blockMutex);
+
+    for (int lx = 0; lx < CHUNK_SIZE; lx++) {
+        for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+            float n = heightNoise[lx * CHUNK_SIZE + lz];
             int height = baseHeight + static_cast<int>(n * amplitude);
             if (height < 0) height = 0;
             if (height >= CHUNK_HEIGHT) height = CHUNK_HEIGHT - 1;
 
-            for (int y = 0; y < CHUNK_HEIGHT; y++) {
-                if (y > height)
-                    blocks[lx][y][lz] = {BlockType::AIR};
-                else if (y == height)
-                    blocks[lx][y][lz] = {BlockType::GRASS};
+            // sections start out as air (null), so only the filled part of the column is written
+            for (int y = 0; y <= height; y++) {
+                if (y == height)
+                    setBlockUnlocked(lx, y, lz, {BlockType::GRASS});
                 else if (y > height - 3)
-                    blocks[lx][y][lz] = {BlockType::DIRT};
+                    setBlockUnlocked(lx, y, lz, {BlockType::DIRT});
                 else
-                    blocks[lx][y][lz] = {BlockType::STONE};
+                    setBlockUnlocked(lx, y, lz, {BlockType::STONE});
             }
 
             // improved tree placement: more likely and spherical canopy
-            float treeNoise = Noise::perlin2d(wx * 0.05f, wz * 0.05f);
+            float treeNoise = treeNoiseGrid[lx * CHUNK_SIZE + lz];
             // reduced density but more forgiving threshold
             const float treeThreshold = 0.68f;
-            if (blocks[lx][height][lz].type == BlockType::GRASS && treeNoise > treeThreshold && ((lx + lz) % 6 == 0) && height + 6 < CHUNK_HEIGHT) {
+            if (getBlockUnlocked(lx, height, lz).type == BlockType::GRASS && treeNoise > treeThreshold && ((lx + lz) % 6 == 0) && height + 6 < CHUNK_HEIGHT) {
                 int trunkH = 4 + std::max(0, static_cast<int>(std::floor((treeNoise - treeThreshold) * 6.0f)));
                 // clamp trunk height
                 trunkH = std::min(trunkH, 6);
                 // trunk
                 for (int ty = height+1; ty <= height + trunkH; ++ty) {
-                    blocks[lx][ty][lz] = {BlockType::WOOD};
+                    setBlockUnlocked(lx, ty, lz, {BlockType::WOOD});
                 }
                 // spherical-ish leaves canopy
                 int top = height + trunkH;
@@ -57,30 +112,113 @@ void Chunk::generate() {
                     if (ax < 0 || ax >= CHUNK_SIZE || az < 0 || az >= CHUNK_SIZE || ay < 0 || ay >= CHUNK_HEIGHT) continue;
                     // don't overwrite trunk
                     if (dx == 0 && dz == 0 && dy <= 2 && dy >= 0) continue;
-                    if (blocks[ax][ay][az].type == BlockType::AIR) blocks[ax][ay][az] = {BlockType::LEAVES};
+                    if (getBlockUnlocked(ax, ay, az).type == BlockType::AIR) setBlockUnlocked(ax, ay, az, {BlockType::LEAVES});
                 }
             }
         }
     }
-    // mark mesh to be built on the main (GL) thread
+    // queue a mesh build of every section
+    blockRevision.fetch_add(1);
+    dirtySections = 0xFF;
     needsMesh = true;
 }
 
-void Chunk::rebuildMesh(const ResourcePack* rp) {
-    if (mesh) delete mesh;
-    mesh = new Mesh();
-    mesh->buildFromChunk(this, x, z, rp);
-    needsMesh = false;
+void Chunk::uploadMesh(const SharedSectionVertices& sections, const SectionVersions& versions,
+                       const SectionQuadCounts& cutoutQuads, const SectionConnectivity& connectivity) {
+    // unchanged sections keep their arena ranges across uploads
+    if (!mesh) mesh = Mesh::pool().acquire();
+    mesh->originX = x * CHUNK_SIZE;
+    mesh->originZ = z * CHUNK_SIZE;
+    mesh->uploadSections(sections, versions, cutoutQuads);
+    mesh->connectivity = connectivity;
 }
 
 Block Chunk::getBlock(int lx, int y, int lz) const {
-    return blocks[lx][y][lz];
+    std::shared_lock<std::shared_mutex> lk(blockMutex);
+    return getBlockUnlocked(lx, y, lz);
 }
 
 void Chunk::setBlock(int lx, int y, int lz, Block block) {
-    blocks[lx][y][lz] = block;
+    std::unique_lock<std::shared_mutex> lk(blockMutex);
+    setBlockUnlocked(lx, y, lz, block);
+    blockRevision.fetch_add(1);
+    // the block's own section, and the one above or below when it sits on their boundary
+    markSectionDirty(y);
+    if (y % SECTION_HEIGHT == 0) markSectionDirty(y - 1);
+    if (y % SECTION_HEIGHT == SECTION_HEIGHT - 1) markSectionDirty(y + 1);
+}
+
+void Chunk::setBlockUnlocked(int lx, int y, int lz, Block block) {
+    int si = y / SECTION_HEIGHT;
+    auto& s = sections[si];
+    if (!s) {
+        if (!block.isSolid()) return; // air into an empty section is a no-op
+        s = ChunkSection::acquire();
+    }
+    int idx = ChunkSection::blockIndex(lx, y % SECTION_HEIGHT, lz);
+    Block old = s->blocks.get(idx);
+    bool wasSolid = old.isSolid();
+    s->blocks.set(idx, block);
+    s->solidCount += static_cast<int>(block.isSolid()) - static_cast<int>(wasSolid);
+    s->opaqueCount += static_cast<int>(!block.passesLight()) - static_cast<int>(!old.passesLight());
+
+    sectionFill[si] = s->fill();
+    if (sectionFill[si] == SectionFill::AIR) s.reset(); // drop sections that became all air again
+
+    // keep the column height current: raise on placement above it, rescan below on removal of the top
+    int16_t& top = heightmap[lz * CHUNK_SIZE + lx];
+    if (block.isSolid()) {
+        if (y > top) top = static_cast<int16_t>(y);
+    } else if (wasSolid && y == top) {
+        top = static_cast<int16_t>(columnTopUnlocked(lx, lz, y - 1));
+    }
+}
+
+uint8_t& Chunk::lightRef(int lx, int y, int lz) {
+    int si = y / SECTION_HEIGHT;
+    SectionLightPtr& l = light[si];
+    if (!l) {
+        l = SectionLight::acquire();
+        l->levels.fill(lightFill[si]);
+    }
+    return l->levels[ChunkSection::blockIndex(lx, y % SECTION_HEIGHT, lz)];
+}
+
+void Chunk::compactLightUnlocked(int si) {
+    SectionLightPtr& l = light[si];
+    if (!l) return;
+    uint8_t first = l->levels[0];
+    for (uint8_t v : l->levels)
+        if (v != first) return;
+    lightFill[si] = first;
+    l.reset();
+}
+
+int Chunk::columnTopUnlocked(int lx, int lz, int fromY) const {
+    for (int si = fromY / SECTION_HEIGHT; si >= 0; --si) {
+        const ChunkSection* s = sections[si].get();
+        if (!s) continue;
+        int ly = (si == fromY / SECTION_HEIGHT) ? fromY % SECTION_HEIGHT : SECTION_HEIGHT - 1;
+        for (; ly >= 0; --ly) {
+            if (s->blocks.get(ChunkSection::blockIndex(lx, ly, lz)).isSolid())
+                return si * SECTION_HEIGHT + ly;
+        }
+    }
+    return -1;
+}
+
+void Chunk::recomputeHeightmapUnlocked() {
+    for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+            heightmap[lz * CHUNK_SIZE + lx] = static_cast<int16_t>(columnTopUnlocked(lx, lz, CHUNK_HEIGHT - 1));
+}
+
+int Chunk::surfaceHeight(int lx, int lz) const {
+    std::shared_lock<std::shared_mutex> lk(blockMutex);
+    return heightmap[lz * CHUNK_SIZE + lx];
 }
 
 Chunk::~Chunk() {
-    if (mesh) delete mesh;
+    // may run on any thread: the GL thread gives the mesh's arena ranges back
+    Mesh::releaseLater(mesh);
 }
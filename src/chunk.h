@@ -1,26 +1,140 @@
 #pragma once
 #include "block.h"
+#include "block_storage.h"
+#include "pool.h"
 #include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
 
 constexpr int CHUNK_SIZE = 16;
 constexpr int CHUNK_HEIGHT = 128;
+constexpr int SECTION_HEIGHT = 16;
+constexpr int SECTION_COUNT = CHUNK_HEIGHT / SECTION_HEIGHT;
+constexpr int SECTION_VOLUME = CHUNK_SIZE * SECTION_HEIGHT * CHUNK_SIZE;
+constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_HEIGHT * CHUNK_SIZE;
+
+enum class MeshMode; // mesh.h
+struct PackedVertex; // mesh.h
+struct SectionMeshCache; // mesh.h
+
+// what a 16-high section holds; AIR sections are not allocated at all. OPAQUE
+// ones stop light and sight everywhere (no air, no leaves): the mesher skips
+// them when buried among other OPAQUE sections, light never enters them
+enum class SectionFill : uint8_t {
+    AIR = 0,
+    OPAQUE,
+    MIXED,
+};
+
+struct ChunkSection {
+    BlockStorage blocks{SECTION_VOLUME};
+    int solidCount = 0;  // blocks that are not air
+    int opaqueCount = 0; // blocks light does not pass (Block::passesLight)
+
+    static int blockIndex(int lx, int ly, int lz) { return (ly * CHUNK_SIZE + lz) * CHUNK_SIZE + lx; }
+    // recompute the counts from the blocks, e.g. after assigning them wholesale
+    void recount();
+    SectionFill fill() const {
+        if (solidCount == 0) return SectionFill::AIR;
+        return opaqueCount == SECTION_VOLUME ? SectionFill::OPAQUE : SectionFill::MIXED;
+    }
+
+    // sections are recycled through a shared pool so their index words are reused
+    static ObjectPool<ChunkSection>& pool();
+    struct Recycle { void operator()(ChunkSection* s) const; };
+    static std::unique_ptr<ChunkSection, Recycle> acquire();
+};
+using SectionPtr = std::unique_ptr<ChunkSection, ChunkSection::Recycle>;
+
+// sky light (high nibble) and block light (low nibble) of a section's blocks,
+// indexed like ChunkSection::blockIndex; pooled like the block sections
+struct SectionLight {
+    std::array<uint8_t, SECTION_VOLUME> levels;
+
+    static ObjectPool<SectionLight>& pool();
+    struct Recycle { void operator()(SectionLight* l) const; };
+    static std::unique_ptr<SectionLight, Recycle> acquire();
+};
+using SectionLightPtr = std::unique_ptr<SectionLight, SectionLight::Recycle>;
 
 class Chunk {
 public:
     int x, z;
-    std::array<std::array<std::array<Block, CHUNK_SIZE>, CHUNK_HEIGHT>, CHUNK_SIZE> blocks;
+    // 16-high vertical sections, null while entirely air; guarded by blockMutex
+    std::array<SectionPtr, SECTION_COUNT> sections;
+    std::array<SectionFill, SECTION_COUNT> sectionFill{}; // kept with sections, same lock
+    // top solid y per column (index lz * CHUNK_SIZE + lx), -1 for empty columns;
+    // kept current by setBlockUnlocked, guarded by blockMutex
+    std::array<int16_t, CHUNK_SIZE * CHUNK_SIZE> heightmap;
+    // light of each section; null while the whole section is lit alike (open
+    // sky above the terrain, darkness deep inside it), which lightFill then
+    // holds. Written by LightEngine, guarded by blockMutex
+    std::array<SectionLightPtr, SECTION_COUNT> light;
+    std::array<uint8_t, SECTION_COUNT> lightFill{};
+    mutable std::shared_mutex blockMutex;
 
     // GPU mesh
     class Mesh* mesh = nullptr;
 
-    // set when block data exists but mesh needs rebuilding on main thread
-    bool needsMesh = false;
+    // set when block data exists but the mesh needs rebuilding (picked up by World::processMeshQueue)
+    std::atomic<bool> needsMesh{false};
+    // bumped by setBlock and generate; a mesh built from an older revision is stale
+    std::atomic<uint64_t> blockRevision{0};
+    // mesh builds are numbered when queued; an older build never replaces a newer
+    // upload (main thread only)
+    uint64_t meshSerial = 0, uploadedMeshSerial = 0;
+    // sections whose faces may have changed since the last mesh build (bit per section)
+    std::atomic<uint8_t> dirtySections{0xFF};
+    // per-section CPU vertices kept between builds so edits rebuild one section
+    std::unique_ptr<SectionMeshCache> meshCache;
+    // level of detail the mesh is built at: blocks merged 2^lod to a side (set by World by distance)
+    std::atomic<uint8_t> lod{0};
+    // set when blocks were edited after generation
+    std::atomic<bool> modified{false};
+    // residency tick of the last access, used to evict least recently used chunks first
+    std::atomic<uint64_t> lastUsed{0};
 
     Chunk(int cx, int cz);
 
     void generate(); // fill blocks (can be called from background thread)
-    void rebuildMesh(const class ResourcePack* rp = nullptr); // must be called from GL thread
+    // update the GPU mesh with sections built off-thread by Mesh::buildSections (GL thread only)
+    void uploadMesh(const std::array<std::shared_ptr<const std::vector<PackedVertex>>, SECTION_COUNT>& sections,
+                    const std::array<uint32_t, SECTION_COUNT>& versions,
+                    const std::array<uint32_t, SECTION_COUNT>& cutoutQuads,
+                    const std::array<uint16_t, SECTION_COUNT>& connectivity);
+    // flag the section holding y for the next mesh build
+    void markSectionDirty(int y) {
+        if (y >= 0 && y < CHUNK_HEIGHT) dirtySections.fetch_or(static_cast<uint8_t>(1u << (y / SECTION_HEIGHT)));
+    }
+    // light byte of a block (lock held)
+    uint8_t lightAt(int lx, int y, int lz) const {
+        const SectionLight* l = light[y / SECTION_HEIGHT].get();
+        return l ? l->levels[ChunkSection::blockIndex(lx, y % SECTION_HEIGHT, lz)] : lightFill[y / SECTION_HEIGHT];
+    }
+    // writable light byte of a block; gives its section storage if it has none (lock held)
+    uint8_t& lightRef(int lx, int y, int lz);
+    // drop section si's storage again if all of it is lit alike (lock held)
+    void compactLightUnlocked(int si);
     Block getBlock(int lx, int y, int lz) const;
     void setBlock(int lx, int y, int lz, Block block);
+    // top solid y in a column, -1 if the column is empty (O(1), from the heightmap)
+    int surfaceHeight(int lx, int lz) const;
+    // rebuild the heightmap from the sections, e.g. after bulk-loading them (lock held)
+    void recomputeHeightmapUnlocked();
+
+    // variants for callers that already hold blockMutex (e.g. the mesher walking the whole chunk)
+    Block getBlockUnlocked(int lx, int y, int lz) const {
+        const ChunkSection* s = sections[y / SECTION_HEIGHT].get();
+        if (!s) return Block{BlockType::AIR};
+        return s->blocks.get(ChunkSection::blockIndex(lx, y % SECTION_HEIGHT, lz));
+    }
+    void setBlockUnlocked(int lx, int y, int lz, Block block);
     ~Chunk();
+
+private:
+    // top solid y in a column at or below fromY, -1 if none (lock held)
+    int columnTopUnlocked(int lx, int lz, int fromY) const;
 };
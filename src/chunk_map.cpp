@@ -0,0 +1,90 @@
+#include "chunk_map.h"
+#include <mutex>
+
+ChunkPtr ChunkMap::find(int cx, int cz) const {
+    const Shard& s = shardFor(cx, cz);
+    std::shared_lock<std::shared_mutex> lk(s.mutex);
+    auto it = s.map.find(key(cx, cz));
+    if (it == s.map.end()) return nullptr;
+    return it->second;
+}
+
+bool ChunkMap::contains(int cx, int cz) const {
+    const Shard& s = shardFor(cx, cz);
+    std::shared_lock<std::shared_mutex> lk(s.mutex);
+    return s.map.count(key(cx, cz)) != 0;
+}
+
+bool ChunkMap::reserve(int cx, int cz) {
+    Shard& s = shardFor(cx, cz);
+    std::unique_lock<std::shared_mutex> lk(s.mutex);
+    return s.map.try_emplace(key(cx, cz), nullptr).second;
+}
+
+void ChunkMap::publish(int cx, int cz, ChunkPtr chunk) {
+    Shard& s = shardFor(cx, cz);
+    std::unique_lock<std::shared_mutex> lk(s.mutex);
+    ChunkPtr& slot = s.map[key(cx, cz)];
+    if (!slot && chunk) loaded.fetch_add(1, std::memory_order_relaxed);
+    else if (slot && !chunk) loaded.fetch_sub(1, std::memory_order_relaxed);
+    slot = std::move(chunk);
+    lk.unlock();
+    logChange(cx, cz);
+}
+
+ChunkPtr ChunkMap::erase(int cx, int cz) {
+    Shard& s = shardFor(cx, cz);
+    std::unique_lock<std::shared_mutex> lk(s.mutex);
+    auto it = s.map.find(key(cx, cz));
+    if (it == s.map.end()) return nullptr;
+    ChunkPtr c = std::move(it->second);
+    s.map.erase(it);
+    lk.unlock();
+    if (c) {
+        loaded.fetch_sub(1, std::memory_order_relaxed);
+        logChange(cx, cz);
+    }
+    return c;
+}
+
+void ChunkMap::logChange(int cx, int cz) {
+    // logged after the slot is written: whoever reads the entry then finds the new state
+    std::lock_guard<std::mutex> lk(journalMutex);
+    uint64_t v = changes.load(std::memory_order_relaxed) + 1;
+    journal[v % JOURNAL_SIZE] = key(cx, cz);
+    changes.store(v, std::memory_order_release);
+}
+
+bool ChunkMap::changesSince(uint64_t since, std::vector<uint64_t>& keys, uint64_t& now) const {
+    std::lock_guard<std::mutex> lk(journalMutex);
+    now = changes.load(std::memory_order_relaxed);
+    if (since < journalBase || since > now || now - since > JOURNAL_SIZE) return false;
+    for (uint64_t v = since + 1; v <= now; ++v) keys.push_back(journal[v % JOURNAL_SIZE]);
+    return true;
+}
+
+void ChunkMap::forEach(const std::function<void(const ChunkPtr&)>& fn) const {
+    for (const Shard& s : shards) {
+        std::shared_lock<std::shared_mutex> lk(s.mutex);
+        for (const auto& [k, c] : s.map)
+            if (c) fn(c);
+    }
+}
+
+std::vector<ChunkPtr> ChunkMap::snapshot() const {
+    std::vector<ChunkPtr> out;
+    out.reserve(size());
+    forEach([&](const ChunkPtr& c) { out.push_back(c); });
+    return out;
+}
+
+void ChunkMap::clear() {
+    for (Shard& s : shards) {
+        std::unique_lock<std::shared_mutex> lk(s.mutex);
+        s.map.clear();
+    }
+    loaded.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lk(journalMutex);
+    journalBase = changes.load(std::memory_order_relaxed) + 1;
+    changes.store(journalBase, std::memory_order_release);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "chunk.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+using ChunkPtr = std::shared_ptr<Chunk>;
+
+// Concurrent chunk index. Keys are spread over independently locked shards so
+// lookups from the render loop, raycasts, generator and network threads only
+// contend when they hit the same shard, and then only with writers.
+// Values are shared_ptrs: a chunk handed out by find() stays alive even if it
+// is erased from the map while the caller still uses it.
+class ChunkMap {
+public:
+    static constexpr int SHARD_COUNT = 64;
+
+    ChunkMap() = default;
+    ChunkMap(const ChunkMap&) = delete;
+    ChunkMap& operator=(const ChunkMap&) = delete;
+
+    // loaded chunk at cx,cz or null (also null while the slot is only reserved)
+    ChunkPtr find(int cx, int cz) const;
+    // true if the slot is loaded or reserved
+    bool contains(int cx, int cz) const;
+    // claim an empty slot so exactly one thread builds the chunk; false if taken
+    bool reserve(int cx, int cz);
+    // fill a reserved (or empty) slot
+    void publish(int cx, int cz, ChunkPtr chunk);
+    // remove the slot, returning the chunk it held (if any)
+    ChunkPtr erase(int cx, int cz);
+
+    // number of loaded (published) chunks
+    size_t size() const { return loaded.load(std::memory_order_relaxed); }
+    // bumped whenever a chunk is published or removed, so callers can cache views of the set
+    uint64_t version() const { return changes.load(std::memory_order_acquire); }
+    // keys (see key()) of the slots changed after version `since`, oldest first,
+    // possibly repeated; now is the version they bring a view up to. False when
+    // they are no longer all known (too far behind, or the map was cleared since),
+    // then the caller rereads snapshot()
+    bool changesSince(uint64_t since, std::vector<uint64_t>& keys, uint64_t& now) const;
+
+    // visit every loaded chunk; each shard is read-locked while it is visited,
+    // so fn must not call back into the map for writing
+    void forEach(const std::function<void(const ChunkPtr&)>& fn) const;
+    std::vector<ChunkPtr> snapshot() const;
+    void clear();
+
+    static uint64_t key(int cx, int cz) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cz);
+    }
+
+private:
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<uint64_t, ChunkPtr> map; // null value = reserved
+    };
+    std::array<Shard, SHARD_COUNT> shards;
+    std::atomic<size_t> loaded{0};
+    std::atomic<uint64_t> changes{0};
+
+    // key of the slot behind each of the last JOURNAL_SIZE versions
+    static constexpr size_t JOURNAL_SIZE = 4096;
+    mutable std::mutex journalMutex;
+    std::array<uint64_t, JOURNAL_SIZE> journal{};
+    uint64_t journalBase = 0; // versions up to here cannot be replayed
+    void logChange(int cx, int cz);
+
+    Shard& shardFor(int cx, int cz) { return shards[shardIndex(cx, cz)]; }
+    const Shard& shardFor(int cx, int cz) const { return shards[shardIndex(cx, cz)]; }
+    static int shardIndex(int cx, int cz) {
+        // neighbouring chunks land in different shards
+        uint32_t h = static_cast<uint32_t>(cx) * 73856093u ^ static_cast<uint32_t>(cz) * 19349663u;
+        return static_cast<int>((h ^ (h >> 16)) & (SHARD_COUNT - 1));
+    }
+};
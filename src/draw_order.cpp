@@ -0,0 +1,47 @@
+#include "draw_order.h"
+#include <algorithm>
+#include <cmath>
+
+const std::vector<ChunkPtr>& ChunkDrawOrder::update(const ChunkMap& chunks, float eyeX, float eyeZ) {
+    int cx = static_cast<int>(std::floor(eyeX / CHUNK_SIZE));
+    int cz = static_cast<int>(std::floor(eyeZ / CHUNK_SIZE));
+    auto dist = [&](const ChunkPtr& c) { return (c->x - cx) * (c->x - cx) + (c->z - cz) * (c->z - cz); };
+    auto nearer = [&](const ChunkPtr& a, const ChunkPtr& b) { return dist(a) < dist(b); };
+
+    if (cx != centerX || cz != centerZ) {
+        // one chunk of movement barely changes the order
+        for (size_t i = 1; i < order.size(); ++i) {
+            for (size_t j = i; j > 0 && nearer(order[j], order[j - 1]); --j) std::swap(order[j], order[j - 1]);
+        }
+        centerX = cx;
+        centerZ = cz;
+    }
+
+    changed.clear();
+    uint64_t now = 0;
+    if (!chunks.changesSince(version, changed, now)) {
+        // first use, cleared map or too far behind: start over (the version is read
+        // first, so changes racing the snapshot are replayed next time, not lost)
+        version = now;
+        order = chunks.snapshot();
+        std::sort(order.begin(), order.end(), nearer);
+        return order;
+    }
+    version = now;
+    if (changed.empty()) return order;
+
+    // drop every changed slot's entry, then merge back what those slots hold now
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    order.erase(std::remove_if(order.begin(), order.end(), [&](const ChunkPtr& c) {
+        return std::binary_search(changed.begin(), changed.end(), ChunkMap::key(c->x, c->z));
+    }), order.end());
+    size_t kept = order.size();
+    for (uint64_t k : changed) {
+        if (ChunkPtr c = chunks.find(static_cast<int32_t>(k >> 32), static_cast<int32_t>(k & 0xFFFFFFFFu)))
+            order.push_back(std::move(c));
+    }
+    std::sort(order.begin() + kept, order.end(), nearer);
+    std::inplace_merge(order.begin(), order.begin() + kept, order.end(), nearer);
+    return order;
+}
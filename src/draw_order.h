@@ -0,0 +1,27 @@
+#pragma once
+#include "chunk_map.h"
+#include <cstdint>
+#include <vector>
+
+// Loaded chunks nearest first from the camera's chunk, so chunk meshes are drawn
+// front to back and early-Z rejects what nearer chunks already cover. The list
+// is kept between frames: chunks published or evicted since the last update
+// (ChunkMap::changesSince) are removed and merged back in, and moving into
+// another chunk re-sorts the nearly sorted list with an insertion sort. The
+// whole set is only re-read when the map's journal cannot replay the changes.
+// Main thread.
+class ChunkDrawOrder {
+public:
+    const std::vector<ChunkPtr>& update(const ChunkMap& chunks, float eyeX, float eyeZ);
+    // let go of the chunks (they keep their meshes alive while listed here)
+    void clear() {
+        order.clear();
+        version = ~uint64_t(0);
+    }
+
+private:
+    std::vector<ChunkPtr> order;
+    std::vector<uint64_t> changed; // ChunkMap keys, kept to reuse its storage
+    uint64_t version = ~uint64_t(0);
+    int centerX = 0, centerZ = 0;
+};
@@ -0,0 +1,152 @@
+#include "job_pool.h"
+#include "chunk.h"
+#include <algorithm>
+#include <cmath>
+
+JobPool::JobPool(unsigned threads) {
+    if (threads == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        threads = hw > 1 ? hw - 1 : 1;
+    }
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back(&JobPool::workerLoop, this);
+}
+
+JobPool::~JobPool() {
+    shutdown();
+}
+
+void JobPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (stopping && workers.empty()) return;
+        stopping = true;
+        queued.clear();
+        heap.clear();
+        std::fill(std::begin(counts), std::end(counts), 0);
+    }
+    cv.notify_all();
+    for (auto& t : workers)
+        if (t.joinable()) t.join();
+    workers.clear();
+}
+
+uint64_t JobPool::id(int cx, int cz, int kind) {
+    // 31 bits per coordinate is far beyond any reachable chunk
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cx) & 0x7FFFFFFFu) << 33) |
+           (static_cast<uint64_t>(static_cast<uint32_t>(cz) & 0x7FFFFFFFu) << 2) | static_cast<uint64_t>(kind);
+}
+
+bool JobPool::submit(int cx, int cz, int kind, Job job) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (stopping) return false;
+        Key key{cx, cz, kind};
+        uint64_t seq = nextSeq++;
+        auto [it, added] = queued.try_emplace(id(cx, cz, kind), Entry{key, std::move(job), seq});
+        if (!added) return false;
+        ++counts[kind];
+        heap.push_back({score(key), it->first, seq});
+        std::push_heap(heap.begin(), heap.end());
+    }
+    cv.notify_one();
+    return true;
+}
+
+void JobPool::erase(std::unordered_map<uint64_t, Entry>::iterator it) {
+    --counts[it->second.key.kind];
+    queued.erase(it);
+    // the heap keeps the slot until it is popped; rebuild once they pile up
+    if (heap.size() > 2 * queued.size() + 64) rescore();
+}
+
+bool JobPool::cancel(int cx, int cz, int kind) {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = queued.find(id(cx, cz, kind));
+    if (it == queued.end()) return false;
+    erase(it);
+    return true;
+}
+
+std::vector<JobPool::Key> JobPool::cancelIf(const std::function<bool(const Key&)>& pred) {
+    std::vector<Key> dropped;
+    std::lock_guard<std::mutex> lk(mutex);
+    for (auto it = queued.begin(); it != queued.end();) {
+        if (pred(it->second.key)) {
+            dropped.push_back(it->second.key);
+            --counts[it->second.key.kind];
+            it = queued.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (!dropped.empty()) rescore();
+    return dropped;
+}
+
+void JobPool::setFocus(float x, float z, float dirX, float dirZ) {
+    float len = std::sqrt(dirX * dirX + dirZ * dirZ);
+    std::lock_guard<std::mutex> lk(mutex);
+    focusX = x;
+    focusZ = z;
+    if (len > 1e-4f) { focusDirX = dirX / len; focusDirZ = dirZ / len; }
+    // rescore when the focus enters another chunk or turns by more than ~45 degrees
+    int cx = static_cast<int>(std::floor(x / CHUNK_SIZE)), cz = static_cast<int>(std::floor(z / CHUNK_SIZE));
+    if (cx != scoredCX || cz != scoredCZ || focusDirX * scoredDirX + focusDirZ * scoredDirZ < 0.7f) rescore();
+}
+
+void JobPool::rescore() {
+    scoredCX = static_cast<int>(std::floor(focusX / CHUNK_SIZE));
+    scoredCZ = static_cast<int>(std::floor(focusZ / CHUNK_SIZE));
+    scoredDirX = focusDirX;
+    scoredDirZ = focusDirZ;
+    heap.clear();
+    for (const auto& [key, e] : queued) heap.push_back({score(e.key), key, e.seq});
+    std::make_heap(heap.begin(), heap.end());
+}
+
+size_t JobPool::pending(int kind) const {
+    std::lock_guard<std::mutex> lk(mutex);
+    if (kind < 0) return queued.size();
+    return counts[kind];
+}
+
+float JobPool::score(const Key& k) const {
+    // one light job drains every queued update, wherever they are; keyed at
+    // whichever chunk queued first, it would wait behind nearer generation
+    if (k.kind == LIGHT) return -1.0f;
+    // squared distance from the focus to the chunk centre, discounted up to 2x
+    // for chunks in front of the player; lower runs first
+    float dx = (k.cx + 0.5f) * CHUNK_SIZE - focusX;
+    float dz = (k.cz + 0.5f) * CHUNK_SIZE - focusZ;
+    float d2 = dx * dx + dz * dz;
+    float len = std::sqrt(d2);
+    float facing = len > 1e-4f ? (dx * focusDirX + dz * focusDirZ) / len : 1.0f;
+    return d2 * (1.5f - 0.5f * facing);
+}
+
+void JobPool::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [&] { return stopping || !queued.empty(); });
+            if (stopping) return;
+            // every queued entry has a slot, so the heap holds a live one
+            for (;;) {
+                std::pop_heap(heap.begin(), heap.end());
+                Slot top = heap.back();
+                heap.pop_back();
+                auto it = queued.find(top.id);
+                if (it == queued.end() || it->second.seq != top.seq) continue;
+                job = std::move(it->second.job);
+                --counts[it->second.key.kind];
+                queued.erase(it);
+                break;
+            }
+            active.fetch_add(1, std::memory_order_relaxed);
+        }
+        job();
+        active.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
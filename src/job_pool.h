@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Persistent worker threads for per-chunk background work (generation, meshing, lighting).
+// Queued jobs are keyed by chunk and kind and run nearest-first: each is scored
+// against the focus (player position and view direction) when queued and kept
+// in a heap. Moving the focus to another chunk, or turning, rescores the queue
+// once, so the order follows the player without re-queueing anything.
+// LIGHT jobs are not tied to their chunk and always run first.
+// Jobs that have not started yet can be cancelled.
+class JobPool {
+public:
+    using Job = std::function<void()>;
+
+    enum Kind : int {
+        GENERATE = 0,
+        MESH = 1,
+        LIGHT = 2,
+    };
+
+    // threads == 0 picks one worker per core, minus the main thread
+    explicit JobPool(unsigned threads = 0);
+    ~JobPool();
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    // queue job for chunk cx,cz; false if a job of that kind is already queued for it
+    bool submit(int cx, int cz, int kind, Job job);
+    // drop a queued job; false if it is not queued (never was, running, or done)
+    bool cancel(int cx, int cz, int kind);
+    // drop every queued job pred selects; returns the chunks whose jobs were dropped
+    struct Key { int cx, cz, kind; };
+    std::vector<Key> cancelIf(const std::function<bool(const Key&)>& pred);
+
+    // position (world units) and horizontal view direction that order the queue
+    void setFocus(float x, float z, float dirX, float dirZ);
+
+    // queued jobs, of one kind or (kind < 0) all of them
+    size_t pending(int kind = -1) const;
+    int running() const { return active.load(std::memory_order_relaxed); }
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()); }
+
+    // stop accepting work, drop the queue and join the workers
+    void shutdown();
+
+private:
+    struct Entry {
+        Key key;
+        Job job;
+        uint64_t seq; // tells this entry's heap slots from those of an earlier job with its key
+    };
+    // heap slot; slots of cancelled or already popped entries are skipped when popped
+    struct Slot {
+        float score;
+        uint64_t id, seq;
+        // std heaps keep the greatest on top; here that is the lowest score
+        bool operator<(const Slot& o) const { return score > o.score; }
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<uint64_t, Entry> queued; // by id(key)
+    std::vector<Slot> heap;                     // min-heap on score
+    size_t counts[3] = {};                      // queued entries per kind
+    uint64_t nextSeq = 0;
+    std::vector<std::thread> workers;
+    std::atomic<int> active{0};
+    bool stopping = false;
+    float focusX = 0.0f, focusZ = 0.0f, focusDirX = 1.0f, focusDirZ = 0.0f;
+    // focus chunk and direction the queue was last scored against
+    int scoredCX = 0, scoredCZ = 0;
+    float scoredDirX = 1.0f, scoredDirZ = 0.0f;
+
+    static uint64_t id(int cx, int cz, int kind);
+    void workerLoop();
+    float score(const Key& k) const;
+    // score every queued entry again and rebuild the heap (lock held)
+    void rescore();
+    void erase(std::unordered_map<uint64_t, Entry>::iterator it);
+};
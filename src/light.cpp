@@ -0,0 +1,319 @@
+#include "light.h"
+#include <algorithm>
+#include <shared_mutex>
+
+namespace {
+
+enum Channel { SKY = 0, BLOCKLIGHT = 1 }; // sky is the high nibble of Chunk::light
+
+int levelOf(uint8_t v, int ch) { return ch == SKY ? v >> 4 : v & 15; }
+void setLevel(uint8_t& v, int ch, int level) {
+    v = ch == SKY ? static_cast<uint8_t>((v & 0x0F) | (level << 4)) : static_cast<uint8_t>((v & 0xF0) | level);
+}
+
+// neighbour steps; DOWN is where full sky light passes without losing a level
+constexpr int DIRS[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, 0, -1}, {0, 0, 1}, {0, -1, 0}, {0, 1, 0}};
+constexpr int DOWN = 4;
+
+// BFS node: position relative to the window's centre chunk plus a light level
+uint32_t node(int x, int y, int z, int level = 0) {
+    return static_cast<uint32_t>(x + CHUNK_SIZE) | static_cast<uint32_t>(z + CHUNK_SIZE) << 6 |
+           static_cast<uint32_t>(y) << 12 | static_cast<uint32_t>(level) << 19;
+}
+void unpack(uint32_t n, int& x, int& y, int& z, int& level) {
+    x = static_cast<int>(n & 63) - CHUNK_SIZE;
+    z = static_cast<int>((n >> 6) & 63) - CHUNK_SIZE;
+    y = static_cast<int>((n >> 12) & 127);
+    level = static_cast<int>(n >> 19);
+}
+
+// The chunks one update can reach: the centre chunk and its 8 neighbours,
+// addressed by block coordinates relative to the centre's corner (-16..31).
+// Missing chunks and everything outside the window block light.
+struct Window {
+    Chunk* chunks[9] = {};
+    uint8_t dirty[9] = {}; // sections to remesh, per chunk
+
+    static int slot(int x, int z) { return ((z >> 4) + 1) * 3 + (x >> 4) + 1; }
+    Chunk* chunkAt(int x, int y, int z) const {
+        if (x < -CHUNK_SIZE || x >= 2 * CHUNK_SIZE || z < -CHUNK_SIZE || z >= 2 * CHUNK_SIZE || y < 0 || y >= CHUNK_HEIGHT)
+            return nullptr;
+        return chunks[slot(x, z)];
+    }
+    bool open(int x, int y, int z) const {
+        const Chunk* c = chunkAt(x, y, z);
+        if (!c || c->sectionFill[y / SECTION_HEIGHT] == SectionFill::OPAQUE) return false;
+        return c->getBlockUnlocked(x & (CHUNK_SIZE - 1), y, z & (CHUNK_SIZE - 1)).passesLight();
+    }
+    // reading a cell never allocates; writing one gives its section storage
+    static uint8_t get(const Chunk* c, int x, int y, int z) {
+        return c->lightAt(x & (CHUNK_SIZE - 1), y, z & (CHUNK_SIZE - 1));
+    }
+    static uint8_t& cell(Chunk* c, int x, int y, int z) {
+        return c->lightRef(x & (CHUNK_SIZE - 1), y, z & (CHUNK_SIZE - 1));
+    }
+    // the light of x,y,z changed: the faces reading it belong to the blocks around it
+    void touched(int x, int y, int z) {
+        for (const auto& d : DIRS) {
+            int nx = x + d[0], ny = y + d[1], nz = z + d[2];
+            if (chunkAt(nx, ny, nz)) dirty[slot(nx, nz)] |= static_cast<uint8_t>(1u << (ny / SECTION_HEIGHT));
+        }
+    }
+};
+
+// spread light from the queued cells (their current level) into open cells that are darker
+void propagate(Window& w, std::vector<uint32_t>& queue, int ch) {
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int x, y, z, unused;
+        unpack(queue[head], x, y, z, unused);
+        int level = levelOf(Window::get(w.chunkAt(x, y, z), x, y, z), ch);
+        if (level <= 1) continue;
+        for (int d = 0; d < 6; ++d) {
+            int nx = x + DIRS[d][0], ny = y + DIRS[d][1], nz = z + DIRS[d][2];
+            if (!w.open(nx, ny, nz)) continue;
+            int next = (ch == SKY && d == DOWN && level == LightEngine::MAX_LIGHT) ? level : level - 1;
+            Chunk* c = w.chunkAt(nx, ny, nz);
+            if (levelOf(Window::get(c, nx, ny, nz), ch) >= next) continue;
+            setLevel(Window::cell(c, nx, ny, nz), ch, next);
+            w.touched(nx, ny, nz);
+            queue.push_back(node(nx, ny, nz));
+        }
+    }
+    queue.clear();
+}
+
+// take away the light that came through the queued cells (already darkened,
+// their old level in the node); neighbours lit from elsewhere go on refill
+void unpropagate(Window& w, std::vector<uint32_t>& removal, std::vector<uint32_t>& refill, int ch) {
+    for (size_t head = 0; head < removal.size(); ++head) {
+        int x, y, z, level;
+        unpack(removal[head], x, y, z, level);
+        for (int d = 0; d < 6; ++d) {
+            int nx = x + DIRS[d][0], ny = y + DIRS[d][1], nz = z + DIRS[d][2];
+            Chunk* c = w.chunkAt(nx, ny, nz);
+            if (!c) continue;
+            int nl = levelOf(Window::get(c, nx, ny, nz), ch);
+            if (nl == 0) continue;
+            if (nl < level || (ch == SKY && d == DOWN && level == LightEngine::MAX_LIGHT && nl == level)) {
+                uint8_t& v = Window::cell(c, nx, ny, nz);
+                setLevel(v, ch, 0);
+                w.touched(nx, ny, nz);
+                removal.push_back(node(nx, ny, nz, nl));
+                // a glowing block falls back to its own light
+                int emitted = ch == BLOCKLIGHT
+                    ? c->getBlockUnlocked(nx & (CHUNK_SIZE - 1), ny, nz & (CHUNK_SIZE - 1)).lightEmission()
+                    : 0;
+                if (emitted) {
+                    setLevel(v, ch, emitted);
+                    refill.push_back(node(nx, ny, nz));
+                }
+            } else {
+                refill.push_back(node(nx, ny, nz));
+            }
+        }
+    }
+    removal.clear();
+}
+
+// per-thread BFS queues, reused so relighting does not allocate once warm
+struct Queues {
+    std::vector<uint32_t> removal[2], refill[2];
+};
+Queues& queues() {
+    thread_local Queues q;
+    return q;
+}
+
+void relightBlock(Window& w, int x, int y, int z) {
+    Queues& q = queues();
+    Chunk* c = w.chunkAt(x, y, z);
+    uint8_t& v = Window::cell(c, x, y, z);
+    for (int ch = 0; ch < 2; ++ch) {
+        int old = levelOf(v, ch);
+        if (!old) continue;
+        setLevel(v, ch, 0);
+        w.touched(x, y, z);
+        q.removal[ch].push_back(node(x, y, z, old));
+        unpropagate(w, q.removal[ch], q.refill[ch], ch);
+    }
+    if (w.open(x, y, z)) {
+        // an opened cell fills from whatever light is around it
+        for (const auto& d : DIRS) {
+            int nx = x + d[0], ny = y + d[1], nz = z + d[2];
+            Chunk* n = w.chunkAt(nx, ny, nz);
+            if (!n) continue;
+            uint8_t nv = Window::get(n, nx, ny, nz);
+            for (int ch = 0; ch < 2; ++ch)
+                if (levelOf(nv, ch)) q.refill[ch].push_back(node(nx, ny, nz));
+        }
+        // nothing stands above the top layer
+        if (y == CHUNK_HEIGHT - 1) {
+            setLevel(v, SKY, LightEngine::MAX_LIGHT);
+            w.touched(x, y, z);
+            q.refill[SKY].push_back(node(x, y, z));
+        }
+    }
+    int emitted = c->getBlockUnlocked(x & (CHUNK_SIZE - 1), y, z & (CHUNK_SIZE - 1)).lightEmission();
+    if (emitted > levelOf(v, BLOCKLIGHT)) {
+        setLevel(v, BLOCKLIGHT, emitted);
+        w.touched(x, y, z);
+        q.refill[BLOCKLIGHT].push_back(node(x, y, z));
+    }
+    for (int ch = 0; ch < 2; ++ch) propagate(w, q.refill[ch], ch);
+}
+
+void joinBorders(Window& w) {
+    // light on either side of each shared border spreads across it; the
+    // neighbours' own light was final already, so this only ever raises levels
+    Queues& q = queues();
+    const int sides[4][2] = {{-1, 0}, {CHUNK_SIZE, 0}, {0, -1}, {0, CHUNK_SIZE}};
+    for (int s = 0; s < 4; ++s) {
+        bool alongZ = s < 2; // -X/+X borders run along z
+        int outside = alongZ ? sides[s][0] : sides[s][1];
+        int inside = outside < 0 ? 0 : CHUNK_SIZE - 1;
+        const Chunk* other = w.chunks[alongZ ? Window::slot(outside, 0) : Window::slot(0, outside)];
+        if (!other) continue;
+        for (int y = 0; y < CHUNK_HEIGHT; ++y) {
+            // light cannot cross into an OPAQUE section, so none crosses next to one
+            int si = y / SECTION_HEIGHT;
+            if (w.chunks[4]->sectionFill[si] == SectionFill::OPAQUE || other->sectionFill[si] == SectionFill::OPAQUE) {
+                y += SECTION_HEIGHT - 1;
+                continue;
+            }
+            for (int t = 0; t < CHUNK_SIZE; ++t) {
+                for (int pos : {outside, inside}) {
+                    int x = alongZ ? pos : t, z = alongZ ? t : pos;
+                    uint8_t v = Window::get(w.chunkAt(x, y, z), x, y, z);
+                    for (int ch = 0; ch < 2; ++ch)
+                        if (levelOf(v, ch) > 1) q.refill[ch].push_back(node(x, y, z));
+                }
+            }
+        }
+    }
+    for (int ch = 0; ch < 2; ++ch) propagate(w, q.refill[ch], ch);
+}
+
+} // namespace
+
+void LightEngine::lightChunk(Chunk& c) {
+    std::unique_lock<std::shared_mutex> lk(c.blockMutex);
+    Window w;
+    w.chunks[4] = &c;
+    Queues& q = queues();
+
+    // open sky down to the top block of every column that stops light (through
+    // tree canopies); sections above the tallest column are all sky and get no storage
+    std::array<int, CHUNK_SIZE * CHUNK_SIZE> lightTop;
+    for (int lz = 0; lz < CHUNK_SIZE; ++lz) {
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx) {
+            int y = c.heightmap[lz * CHUNK_SIZE + lx];
+            while (y >= 0 && c.getBlockUnlocked(lx, y, lz).passesLight()) --y;
+            lightTop[lz * CHUNK_SIZE + lx] = y;
+        }
+    }
+    auto topAt = [&](int lx, int lz) { return lightTop[lz * CHUNK_SIZE + lx]; };
+    int tallest = *std::max_element(c.heightmap.begin(), c.heightmap.end());
+    int skyFrom = (tallest + SECTION_HEIGHT) / SECTION_HEIGHT * SECTION_HEIGHT; // first all-sky y
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        c.light[si].reset();
+        c.lightFill[si] = si * SECTION_HEIGHT >= skyFrom ? static_cast<uint8_t>(MAX_LIGHT << 4) : 0;
+    }
+    for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx)
+            for (int y = topAt(lx, lz) + 1; y < std::min(skyFrom, CHUNK_HEIGHT); ++y)
+                setLevel(c.lightRef(lx, y, lz), SKY, MAX_LIGHT);
+
+    // it only spreads sideways next to taller columns (overhangs, cave mouths)
+    for (int lz = 0; lz < CHUNK_SIZE; ++lz) {
+        for (int lx = 0; lx < CHUNK_SIZE; ++lx) {
+            int reach = -1;
+            for (const auto& d : DIRS) {
+                int nx = lx + d[0], nz = lz + d[2];
+                if ((d[0] || d[2]) && nx >= 0 && nx < CHUNK_SIZE && nz >= 0 && nz < CHUNK_SIZE)
+                    reach = std::max(reach, topAt(nx, nz));
+            }
+            for (int y = topAt(lx, lz) + 1; y <= reach; ++y) q.refill[SKY].push_back(node(lx, y, lz));
+        }
+    }
+
+    // glowing blocks, skipping sections whose palette holds none
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        const ChunkSection* s = c.sections[si].get();
+        if (!s) continue;
+        bool glows = false;
+        for (const Block& b : s->blocks.getPalette()) glows = glows || b.lightEmission() > 0;
+        if (!glows) continue;
+        for (int i = 0; i < SECTION_VOLUME; ++i) {
+            int e = s->blocks.get(i).lightEmission();
+            if (!e) continue;
+            int lx = i % CHUNK_SIZE, lz = (i / CHUNK_SIZE) % CHUNK_SIZE, y = si * SECTION_HEIGHT + i / (CHUNK_SIZE * CHUNK_SIZE);
+            setLevel(c.lightRef(lx, y, lz), BLOCKLIGHT, e);
+            q.refill[BLOCKLIGHT].push_back(node(lx, y, lz));
+        }
+    }
+
+    for (int ch = 0; ch < 2; ++ch) propagate(w, q.refill[ch], ch);
+    // sections that ended up lit alike (e.g. solid rock) give their storage back
+    for (int si = 0; si < SECTION_COUNT; ++si) c.compactLightUnlocked(si);
+}
+
+void LightEngine::queueBlock(int wx, int wy, int wz, uint16_t remesh) {
+    int cx = wx >> 4, cz = wz >> 4;
+    std::lock_guard<std::mutex> lk(queueMutex);
+    queue.push_back({cx, cz, wx - cx * CHUNK_SIZE, wy, wz - cz * CHUNK_SIZE, false, remesh});
+}
+
+void LightEngine::queueBorders(int cx, int cz) {
+    std::lock_guard<std::mutex> lk(queueMutex);
+    queue.push_back({cx, cz, 0, 0, 0, true, 0});
+}
+
+size_t LightEngine::pending() const {
+    std::lock_guard<std::mutex> lk(queueMutex);
+    return queue.size();
+}
+
+void LightEngine::apply(const Update& u) {
+    ChunkPtr held[9];
+    Window w;
+    for (int dz = -1; dz <= 1; ++dz)
+        for (int dx = -1; dx <= 1; ++dx) {
+            int i = (dz + 1) * 3 + dx + 1;
+            held[i] = chunks.find(u.cx + dx, u.cz + dz);
+            w.chunks[i] = held[i].get();
+        }
+    if (!w.chunks[4]) return; // unloaded since
+    {
+        // always taken in window order, and only by one update at a time
+        std::lock_guard<std::mutex> run(runMutex);
+        std::unique_lock<std::shared_mutex> locks[9];
+        for (int i = 0; i < 9; ++i)
+            if (held[i]) locks[i] = std::unique_lock<std::shared_mutex>(held[i]->blockMutex);
+        if (u.borders) joinBorders(w);
+        else relightBlock(w, u.lx, u.y, u.lz);
+        // changed air sections are the ones that can turn evenly lit again
+        for (int i = 0; i < 9; ++i)
+            for (int si = 0; si < SECTION_COUNT; ++si)
+                if ((w.dirty[i] >> si & 1u) && !held[i]->sections[si]) held[i]->compactLightUnlocked(si);
+    }
+    for (int i = 0; i < 9; ++i) {
+        if (!held[i] || !(w.dirty[i] || (u.remesh >> i & 1u))) continue;
+        held[i]->dirtySections.fetch_or(w.dirty[i]);
+        held[i]->needsMesh = true;
+    }
+}
+
+void LightEngine::process() {
+    std::vector<Update> batch;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lk(queueMutex);
+            batch.swap(queue);
+        }
+        if (batch.empty()) return;
+        // an edit's remesh waits on it, so edits go ahead of streaming's joins
+        std::stable_partition(batch.begin(), batch.end(), [](const Update& u) { return !u.borders; });
+        for (const Update& u : batch) apply(u);
+        batch.clear();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "chunk.h"
+#include "chunk_map.h"
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Flood-fill sky and block light, stored per block in Chunk::light (sections
+// lit evenly throughout keep only a Chunk::lightFill byte).
+// Sky light is 15 under the open sky, keeps 15 going straight down and loses
+// one level per other step; block light spreads from glowing blocks
+// (Block::lightEmission) losing one level per step. Blocks stop both, except
+// see-through ones like leaves (Block::passesLight).
+// A chunk is lit from its own blocks when it is generated or loaded
+// (lightChunk), then joined with its neighbours across its borders once
+// published. Edits relight incrementally: the light that passed through the
+// changed block is removed with one BFS and the hole refilled from the light
+// around it with another, so an update never reaches past the 3x3 chunks
+// around it. Edits and border joins are queued from any thread and applied by
+// process() (World runs it as a job on the pool), edits first. One update runs
+// at a time; the lock is let go between updates, so nothing else waits behind
+// a whole batch.
+class LightEngine {
+public:
+    static constexpr int MAX_LIGHT = 15;
+
+    explicit LightEngine(ChunkMap& chunks) : chunks(chunks) {}
+    LightEngine(const LightEngine&) = delete;
+    LightEngine& operator=(const LightEngine&) = delete;
+
+    // light c from its own blocks only, e.g. before it is published (takes c's lock)
+    static void lightChunk(Chunk& c);
+
+    // queue the relight around a changed block (world coords). remesh picks the
+    // chunks of the 3x3 window around it (bit (dz + 1) * 3 + dx + 1) whose
+    // remesh waits for the relight: process() flags them once it is done, so
+    // no build reads the changed cell's old light
+    void queueBlock(int wx, int wy, int wz, uint16_t remesh);
+    // queue the join of a newly published chunk with the loaded chunks around it
+    void queueBorders(int cx, int cz);
+
+    // apply the queued updates; chunks whose light changed get the sections that
+    // read it flagged for remeshing
+    void process();
+    size_t pending() const;
+
+private:
+    struct Update {
+        int cx, cz;
+        int lx, y, lz;   // changed block, chunk-local (unused for border joins)
+        bool borders;
+        uint16_t remesh; // window chunks to flag for meshing afterwards
+    };
+
+    ChunkMap& chunks;
+    mutable std::mutex queueMutex;
+    std::vector<Update> queue;
+    std::mutex runMutex; // serializes updates
+
+    // relight the 3x3 chunks around u (takes runMutex)
+    void apply(const Update& u);
+};
@@ -7,6 +7,8 @@
 #include "shader.h"
 #include "math.h"
 #include "mesh.h"
+#include "occlusion.h"
+#include "draw_order.h"
 #include "shader.h"
 #include "texture.h"
 #include "resourcepack.h"
@@ -50,9 +52,10 @@ int main(int argc, char** argv) {
 
     glEnable(GL_DEPTH_TEST);
 
-    // load voxel shader
-    Shader voxelShader;
-    if (!voxelShader.loadFromFiles("shaders/voxel.vert", "shaders/voxel.frag")) {
+    // load voxel shaders: opaque, and alpha-tested for the leaves pass
+    Shader voxelShader, cutoutShader;
+    if (!voxelShader.loadFromFiles("shaders/voxel.vert", "shaders/voxel.frag") ||
+        !cutoutShader.loadFromFiles("shaders/voxel.vert", "shaders/voxel.frag", "#define CUTOUT\n")) {
         std::cerr << "Failed to load voxel shader\n";
         return -1;
     }
@@ -93,9 +96,19 @@ int main(int argc, char** argv) {
 
     // bind atlas to texture unit 0 and inform shader
     activeAtlas->bind(0);
-    voxelShader.use();
-    voxelShader.setInt("atlas", 0);
-    voxelShader.setInt("atlasTiles", activeAtlas->tiles);
+    // colors / type ids behind the packed vertices' material index
+    auto materials = Mesh::materialPalette(world.resourcePack);
+    for (Shader* s : {&voxelShader, &cutoutShader}) {
+        s->use();
+        s->setInt("atlas", 0);
+        s->setInt("atlasTiles", activeAtlas->tiles);
+        s->setVec4Array("materials", materials.data(), Mesh::MATERIAL_COUNT);
+        s->setMat4("model", Math::identity().data());
+        s->bindBlock("Frame", UniformBuffer::FRAME_BINDING);
+    }
+    // camera data both voxel programs read, written once per frame
+    UniformBuffer frameBuffer;
+    FrameUniforms frameUniforms;
 
     // command-line flags: --server, --port <port>, --connect <host:port>
     bool runServer = false; int serverPort = 69696; std::string connectHost;
@@ -126,13 +139,12 @@ int main(int argc, char** argv) {
         if (client->start(h,p)) g_netClient = client; else { delete client; client = nullptr; }
     }
 
-    // start background pregeneration (only block data) for a small radius
-    world.pregenerateAsync(4);
-
     Player player(0.0f, 0.0f, 0.0f);
 
     // initialize player height
-    player.y = world.getHeightAt(player.x, player.z) + player.eyeHeight;
+    // (the spawn chunk is still streaming in; Player::update lifts the player onto it once loaded)
+    int spawnH = world.getHeightAt(player.x, player.z);
+    player.y = (spawnH == World::HEIGHT_UNKNOWN ? 0 : spawnH) + player.eyeHeight;
 
     // inventory
     Inventory inv;
@@ -147,6 +159,10 @@ int main(int argc, char** argv) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
 
+    // sections hidden behind terrain are skipped (see occlusion.h)
+    OcclusionCuller occlusion;
+    ChunkDrawOrder drawOrder;
+
     // FPS / debug overlay state
     int frames = 0;
     double fpsTimer = 0.0;
@@ -182,8 +198,6 @@ int main(int argc, char** argv) {
         // update
         if (!menu.isOpen()) {
             player.update(window, dt, world, inv);
-            // update world meshes on GL thread
-            world.processMeshQueue(2);
         } else {
             // when menu is open, update menu input
             menu.update(window);
@@ -201,27 +215,37 @@ int main(int argc, char** argv) {
         float radPitch = player.pitch * 3.14159265f / 180.0f;
         Math::Vec3 dir{std::cos(radPitch) * std::cos(radYaw), std::sin(radPitch), std::cos(radPitch) * std::sin(radYaw)};
         Math::Vec3 center{player.x + dir.x, player.y + dir.y, player.z + dir.z};
+        // background generation follows the player and favours what is in view
+        world.setViewer(player.x, player.z, dir.x, dir.z);
         Math::Vec3 up{0.0f,1.0f,0.0f};
         Math::Mat4 view = Math::lookAt(eye, center, up);
 
         // render all chunk meshes
         activeAtlas->bind(0);
+        frameUniforms.projection = proj;
+        frameUniforms.view = view;
+        frameBuffer.update(UniformBuffer::FRAME_BINDING, &frameUniforms, sizeof(frameUniforms));
         voxelShader.use();
-        voxelShader.setMat4("projection", proj.data());
-        voxelShader.setMat4("view", view.data());
-        Math::Mat4 model = Math::identity();
-        voxelShader.setMat4("model", model.data());
-        // set snow line relative to world (could be dynamic)
-        voxelShader.setFloat("snowLine", 80.0f);
-        voxelShader.setFloat("snowBlendRange", 8.0f);
-
-        // process a couple mesh rebuilds per frame on the GL thread
-        world.processMeshQueue(2);
-
-        for (auto &p : world.chunks) {
-            Chunk* c = p.second;
-            if (c && c->mesh) c->mesh->draw();
+
+        // stream chunks around the player: queue generation and meshing, upload
+        // finished meshes within the frame budget, unload what drifted out of range
+        world.updateStreaming(player.x, player.z);
+
+        // queue the sections in view nearest chunk first, then draw each pass in
+        // one indirect multi-draw: opaque, then the alpha-tested leaves
+        Math::Frustum frustum = Math::frustumFromMatrix(Math::multiply(proj, view));
+        occlusion.update(world.chunks, eye, frustum);
+        Mesh::DrawCounts drawCounts;
+        std::array<int, Mesh::MAX_LOD + 1> lodChunks{};
+        for (const ChunkPtr& c : drawOrder.update(world.chunks, eye.x, eye.z)) {
+            if (!c->mesh) continue;
+            world.touch(*c);
+            ++lodChunks[c->lod.load()];
+            c->mesh->draw(frustum, occlusion.visibleSections(c->x, c->z), drawCounts);
         }
+        MeshArena::get().draw(MeshArena::OPAQUE);
+        cutoutShader.use();
+        MeshArena::get().draw(MeshArena::CUTOUT);
 
         // FPS counting and F3 debug overlay toggle
         frames++;
@@ -245,6 +269,16 @@ int main(int argc, char** argv) {
         }
         prevF5 = f5State;
 
+        // cycle the chunk mesher with F6 (naive -> greedy -> binary)
+        static int prevF6 = GLFW_RELEASE;
+        int f6State = glfwGetKey(window, GLFW_KEY_F6);
+        if (f6State == GLFW_PRESS && prevF6 == GLFW_RELEASE) {
+            MeshMode next = world.meshMode == MeshMode::NAIVE ? MeshMode::GREEDY
+                          : world.meshMode == MeshMode::GREEDY ? MeshMode::BINARY : MeshMode::NAIVE;
+            world.setMeshMode(next);
+        }
+        prevF6 = f6State;
+
         // toggle pause menu with ESC
         static int prevEsc = GLFW_RELEASE;
         int escState = glfwGetKey(window, GLFW_KEY_ESCAPE);
@@ -269,9 +303,28 @@ int main(int argc, char** argv) {
             title << "Cubica - FPS: " << fps << " | Pos: (" << player.x << ", " << player.y << ", " << player.z << ")";
             title << " | Chunks: " << world.getChunkCount();
             if (showDebug) {
+                title << " | Mesher: " << (world.meshMode == MeshMode::NAIVE ? "naive" : world.meshMode == MeshMode::GREEDY ? "greedy" : "binary");
+                title << " | Sections: " << drawCounts.drawn << " drawn, " << drawCounts.culled << " culled, "
+                      << drawCounts.occluded << " occluded (" << occlusion.lastVisited() << " walked)";
+                title << " | LOD:";
+                for (int n : lodChunks) title << " " << n;
                 title << " | PendingMesh: " << world.getPendingMeshCount();
+                title << " | Evicted: " << world.getEvictedCount();
+                title << " | GenQueue: " << world.getPendingGenerationCount();
+                auto ss = world.takeStreamingStats();
+                title << " | Stream: " << ss.lastMs << "/" << ss.worstMs << " ms, spikes " << ss.spikes;
                 title << " | RP: " << (world.resourcePack ? "yes" : "none");
                 title << " | Renderer: " << (renderer ? renderer : "unknown");
+                auto sp = ChunkSection::pool().stats();
+                auto mp = Mesh::pool().stats();
+                title << " | SectionPool: " << static_cast<int>(sp.hitRate() * 100.0) << "% hit, "
+                      << sp.live << "+" << sp.pooled << " (" << sp.footprint / 1024 << " KiB)";
+                title << " | MeshPool: " << static_cast<int>(mp.hitRate() * 100.0) << "% hit, "
+                      << mp.live << "+" << mp.pooled;
+                auto as = MeshArena::get().stats();
+                title << " | Arena: " << as.usedQuads / 1024 << "k/" << as.capacityQuads / 1024 << "k quads, "
+                      << as.pendingQuads / 1024 << "k pending, " << as.freeRanges << " holes, "
+                      << as.relayouts << " relayouts, " << as.lastDrawCommands << " draws";
             }
             glfwSetWindowTitle(window, title.str().c_str());
         }
@@ -308,6 +361,15 @@ int main(int argc, char** argv) {
         glfwPollEvents();
     }
 
+    // persist edits, then release chunk meshes while the GL context is still current
+    world.saveAll();
+    drawOrder.clear();
+    world.chunks.clear();
+    Mesh::releasePending();
+    Mesh::pool().trim(0);
+    ChunkSection::pool().trim(0);
+    SectionLight::pool().trim(0);
+
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
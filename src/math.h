@@ -24,6 +24,7 @@ static inline Mat4 perspective(float fovDeg, float aspect, float znear, float zf
 }
 
 struct Vec3 { float x, y, z; };
+struct Vec4 { float x, y, z, w; };
 
 static inline Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up) {
     auto sub = [](const Vec3&a,const Vec3&b){return Vec3{a.x-b.x,a.y-b.y,a.z-b.z};};
@@ -43,4 +44,44 @@ static inline Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up) {
     return m;
 }
 
+// a * b (column-major, so b is applied first)
+static inline Mat4 multiply(const Mat4& a, const Mat4& b) {
+    Mat4 m{};
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            for (int k = 0; k < 4; ++k) m[c * 4 + r] += a[k * 4 + r] * b[c * 4 + k];
+    return m;
+}
+
+// The six clip planes of a projection * view matrix, in world space. Each plane
+// is (a, b, c, d) with a*x + b*y + c*z + d >= 0 on the inside (not normalized).
+struct Frustum {
+    std::array<std::array<float, 4>, 6> planes;
+
+    // true unless the box lies completely outside one plane (may keep boxes
+    // just outside a corner, never drops a visible one)
+    bool intersectsBox(const Vec3& lo, const Vec3& hi) const {
+        for (const auto& p : planes) {
+            // the box corner furthest along the plane normal
+            float x = p[0] >= 0.0f ? hi.x : lo.x;
+            float y = p[1] >= 0.0f ? hi.y : lo.y;
+            float z = p[2] >= 0.0f ? hi.z : lo.z;
+            if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0.0f) return false;
+        }
+        return true;
+    }
+};
+
+// planes of clip = projection * view (Gribb/Hartmann: row 3 +- rows 0..2)
+static inline Frustum frustumFromMatrix(const Mat4& clip) {
+    Frustum f;
+    for (int i = 0; i < 3; ++i) {
+        for (int s = 0; s < 2; ++s) {
+            float sign = s == 0 ? 1.0f : -1.0f;
+            for (int c = 0; c < 4; ++c) f.planes[i * 2 + s][c] = clip[c * 4 + 3] + sign * clip[c * 4 + i];
+        }
+    }
+    return f;
+}
+
 } // namespace Math
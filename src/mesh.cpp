@@ -1,107 +1,292 @@
 #include "mesh.h"
 #include <vector>
 #include <cstring>
+#include <mutex>
+#include <algorithm>
+#include <bit>
 #include "resourcepack.h"
 
-// Vertex layout: pos(xyz), tex(u,v), light, color(r,g,b), typeId, worldY
-// floats per vertex: 3 + 2 + 1 + 3 + 1 + 1 = 11
+// PackedVertex (see mesh.h): chunk-local corner position, face id and light in
+// lo; atlas tile, overlay tile + 1, material and the snow-blend height in hi.
+// The texture coordinate is not stored: voxel.vert derives it from the position
+// along the face's axes, so merged quads repeat the tile once per block.
 
-static void pushVertex(std::vector<float>& v, float x,float y,float z, float u, float tv, float light, float r, float g, float b, float typeId = -1.0f, float worldY = -1.0f, float overlayTile = -1.0f) {
-    v.push_back(x); v.push_back(y); v.push_back(z);
-    v.push_back(u); v.push_back(tv);
-    v.push_back(light);
-    v.push_back(r); v.push_back(g); v.push_back(b);
-    v.push_back(typeId);
-    v.push_back(worldY);
-    v.push_back(overlayTile);
+static PackedVertex packVertex(int x, int y, int z, int face, int light, int tile, int overlay, int material, int worldY) {
+    PackedVertex v;
+    v.lo = static_cast<uint32_t>(x) | (static_cast<uint32_t>(y) << 5) | (static_cast<uint32_t>(z) << 13) |
+           (static_cast<uint32_t>(face) << 18) | (static_cast<uint32_t>(light) << 21);
+    v.hi = static_cast<uint32_t>(tile) | (static_cast<uint32_t>(overlay + 1) << 8) |
+           (static_cast<uint32_t>(material) << 16) | (static_cast<uint32_t>(worldY) << 24);
+    return v;
 }
 
-Mesh::Mesh() {
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-}
 Mesh::~Mesh() {
-    if (vbo) glDeleteBuffers(1, &vbo);
-    if (vao) glDeleteVertexArrays(1, &vao);
-}
-
-void Mesh::upload(const std::vector<float>& data) {
-    // now each vertex has 12 floats (pos(3),tex(2),light(1),color(3),typeId(1),worldY(1),overlay(1))
-    const int strideFloats = 12;
-    vertexCount = data.size() / strideFloats;
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-
-    // layout
-    glEnableVertexAttribArray(0); // pos
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, strideFloats * sizeof(float), (void*)(0));
-    glEnableVertexAttribArray(1); // tex
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, strideFloats * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2); // light
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, strideFloats * sizeof(float), (void*)(5 * sizeof(float)));
-    glEnableVertexAttribArray(3); // color
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, strideFloats * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(4); // typeId
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, strideFloats * sizeof(float), (void*)(9 * sizeof(float)));
-    glEnableVertexAttribArray(5); // worldY
-    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, strideFloats * sizeof(float), (void*)(10 * sizeof(float)));
-    glEnableVertexAttribArray(6); // overlayTile
-    glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, strideFloats * sizeof(float), (void*)(11 * sizeof(float)));
-
-    glBindVertexArray(0);
-}
-
-void Mesh::draw() const {
-    if (vertexCount == 0) return;
-    glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertexCount));
-    glBindVertexArray(0);
+    clear();
 }
 
-void Mesh::buildFromChunk(const Chunk* c, int cx, int cz, const ResourcePack* rp) {
-    std::vector<float> verts;
-    float ox = cx * CHUNK_SIZE;
-    float oz = cz * CHUNK_SIZE;
+ObjectPool<Mesh>& Mesh::pool() {
+    static ObjectPool<Mesh> p(128);
+    return p;
+}
 
-    auto isAir = [&](int lx, int y, int lz) -> bool {
-        if (lx < 0 || lx >= CHUNK_SIZE || lz < 0 || lz >= CHUNK_SIZE || y < 0 || y >= CHUNK_HEIGHT)
-            return true;
-        return !c->getBlock(lx, y, lz).isSolid();
-    };
+static std::mutex releaseMutex;
+static std::vector<Mesh*> releaseQueue;
 
-    // Base color for most blocks (used on sides/bottom, and top when not special)
-    auto baseColorOf = [](BlockType t) -> std::array<float, 3> {
-        switch (t) {
-            case BlockType::DIRT:   return {0.60f, 0.39f, 0.22f};
-            case BlockType::STONE:  return {0.58f, 0.58f, 0.58f};
-            case BlockType::WOOD:   return {0.64f, 0.32f, 0.16f};
-            case BlockType::LEAVES: return {0.40f, 0.70f, 0.30f};
-            default:                return {1.0f, 1.0f, 1.0f};
+void Mesh::releaseLater(Mesh* mesh) {
+    if (!mesh) return;
+    std::lock_guard<std::mutex> lk(releaseMutex);
+    releaseQueue.push_back(mesh);
+}
+
+void Mesh::releasePending() {
+    std::vector<Mesh*> meshes;
+    {
+        std::lock_guard<std::mutex> lk(releaseMutex);
+        meshes.swap(releaseQueue);
+    }
+    for (Mesh* m : meshes) {
+        m->clear();
+        pool().release(m);
+    }
+}
+
+GLuint Mesh::quadIndexBuffer(size_t quads) {
+    // quad q is vertices 4q..4q+3 in every mesh, so one index buffer serves them all;
+    // it only ever grows, keeping its name so VAOs that captured it stay valid
+    static GLuint ibo = 0;
+    static size_t capacity = 0;
+    if (!ibo) glGenBuffers(1, &ibo);
+    if (quads > capacity) {
+        capacity = std::max({quads, capacity * 2, size_t(16384)});
+        std::vector<uint32_t> idx(capacity * 6);
+        for (size_t q = 0; q < capacity; ++q) {
+            uint32_t v = static_cast<uint32_t>(q * 4);
+            uint32_t* i = &idx[q * 6];
+            i[0] = v; i[1] = v + 1; i[2] = v + 2;
+            i[3] = v; i[4] = v + 2; i[5] = v + 3;
         }
-    };
+        glBindVertexArray(0); // don't attach it to whatever VAO is bound
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(uint32_t), idx.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    return ibo;
+}
 
-    // Special top color (only for grass when no resource pack)
-    auto topColorOf = [&](BlockType t) -> std::array<float, 3> {
-        if (t == BlockType::GRASS) {
-            if (!rp) return {0.55f, 0.85f, 0.35f};  // nice natural green tint
-            else     return {1.0f, 1.0f, 1.0f};     // let RP texture decide
+void Mesh::uploadSections(const SharedSectionVertices& sections, const SectionVersions& versions,
+                          const SectionQuadCounts& cutouts) {
+    MeshArena& arena = MeshArena::get();
+    vertexCount = 0;
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        if (versions[si] != uploadedVersions[si]) {
+            // the old range may still be in use by a draw in flight, so write a fresh one
+            static const std::vector<PackedVertex> none;
+            const std::vector<PackedVertex>& v = sections[si] ? *sections[si] : none;
+            PackedVertex* dst = arena.allocate(ranges[si], static_cast<uint32_t>(v.size() / 4));
+            if (dst) std::memcpy(dst, v.data(), v.size() * sizeof(PackedVertex));
+            cutoutQuads[si] = cutouts[si];
+            uploadedVersions[si] = versions[si];
         }
-        return baseColorOf(t);
-    };
+        vertexCount += size_t(ranges[si].quads) * 4;
+    }
+}
+
+void Mesh::clear() {
+    MeshArena& arena = MeshArena::get();
+    for (MeshArena::Range& r : ranges) arena.release(r);
+    cutoutQuads.fill(0);
+    uploadedVersions.fill(0);
+    connectivity.fill(ALL_FACES_CONNECTED);
+    vertexCount = 0;
+}
 
-    auto typeIdOf = [](BlockType t) -> float {
-        switch (t) {
-            case BlockType::GRASS:  return 0.0f;
-            case BlockType::DIRT:   return 1.0f;
-            case BlockType::STONE:  return 2.0f;
-            case BlockType::LEAVES: return 3.0f;
-            default:                return -1.0f;
+void Mesh::draw(const Math::Frustum& frustum, uint8_t visibleSections, DrawCounts& counts) const {
+    if (vertexCount == 0) return;
+    float x0 = static_cast<float>(originX), z0 = static_cast<float>(originZ);
+    float x1 = x0 + CHUNK_SIZE, z1 = z0 + CHUNK_SIZE;
+    int sections = 0;
+    for (const MeshArena::Range& r : ranges) sections += r.quads != 0;
+    // whole column first, then each section
+    if (!frustum.intersectsBox({x0, 0.0f, z0}, {x1, float(CHUNK_HEIGHT), z1})) {
+        counts.culled += sections;
+        return;
+    }
+    MeshArena& arena = MeshArena::get();
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        if (!ranges[si].quads) continue;
+        if (!(visibleSections & (1u << si))) {
+            ++counts.occluded;
+            continue;
         }
-    };
+        float y0 = static_cast<float>(si * SECTION_HEIGHT);
+        if (!frustum.intersectsBox({x0, y0, z0}, {x1, y0 + SECTION_HEIGHT, z1})) {
+            ++counts.culled;
+            continue;
+        }
+        uint32_t opaque = ranges[si].quads - cutoutQuads[si];
+        arena.add(MeshArena::OPAQUE, ranges[si], 0, opaque, originX, originZ);
+        arena.add(MeshArena::CUTOUT, ranges[si], opaque, cutoutQuads[si], originX, originZ);
+        ++counts.drawn;
+    }
+}
+
+namespace {
+
+constexpr int BLOCK_TYPE_COUNT = static_cast<int>(BlockType::LEAVES) + 1;
+static_assert(BLOCK_TYPE_COUNT * 3 <= Mesh::MATERIAL_COUNT, "material palette too small");
+
+// leaves are drawn alpha-tested in their own pass: blocks behind them keep their
+// faces, but leaves hide each other like solid blocks do
+constexpr int CUTOUT_TYPE = static_cast<int>(BlockType::LEAVES);
+// is a face of block type t seen past block type `front`?
+inline bool faceShows(int t, int front) {
+    return front == 0 || (front == CUTOUT_TYPE && t != CUTOUT_TYPE);
+}
+
+// material index of a face: block type x {side, bottom, top}
+int materialOf(BlockType t, int face) {
+    int group = face < 4 ? 0 : face - 3;
+    return static_cast<int>(t) * 3 + group;
+}
 
-    int atlasTileCount = rp ? std::max(1, rp->atlas.tiles) : 5;  // increased fallback
-    float tileW = 1.0f / static_cast<float>(atlasTileCount);
+// everything a face of a given block type and direction looks like
+struct FaceStyle {
+    int tile = 0;
+    int overlay = -1;
+    int material = 0;
+};
+
+// faces: 0 -X, 1 +X, 2 -Z, 3 +Z, 4 bottom, 5 top.
+// u/v are the axes (0 x, 1 y, 2 z) a quad spans (voxel.vert keeps the matching table)
+struct FaceDir {
+    int normal, sign, u, v;
+};
+constexpr FaceDir FACE_DIRS[6] = {
+    {0, -1, 2, 1},
+    {0, +1, 2, 1},
+    {2, -1, 0, 1},
+    {2, +1, 0, 1},
+    {1, -1, 0, 2},
+    {1, +1, 0, 2},
+};
+
+// bit offset of each axis (x, y, z) in PackedVertex::lo
+constexpr int AXIS_SHIFT[3] = {0, 5, 13};
+
+// write the four corners of a w x h rectangle of face `face` whose first cell is
+// block (x, y, z) in chunk-local coords, lit by `light` (a Chunk::light byte);
+// cells are `size` blocks to a side (w and h are in blocks); returns the next
+// free vertex
+PackedVertex* emitQuad(PackedVertex* dst, int face, int x, int y, int z, int w, int h, int light, const FaceStyle& st,
+                       int size = 1) {
+    const FaceDir& d = FACE_DIRS[face];
+    int base[3] = {x, y, z};
+    if (d.sign > 0) base[d.normal] += size;
+    // grass snow blending reads the block's bottom on sides and bottoms, its top on tops
+    int worldY = face == 5 ? y + size : y;
+
+    // everything but the position is shared, so the corners differ by a constant in lo
+    PackedVertex v = packVertex(base[0], base[1], base[2], face, light, st.tile, st.overlay, st.material, worldY);
+    uint32_t du = static_cast<uint32_t>(w) << AXIS_SHIFT[d.u];
+    uint32_t dv = static_cast<uint32_t>(h) << AXIS_SHIFT[d.v];
+    // four corners; the shared index buffer turns them into two triangles
+    dst[0] = v;
+    dst[1] = {v.lo + du, v.hi};
+    dst[2] = {v.lo + du + dv, v.hi};
+    dst[3] = {v.lo + dv, v.hi};
+    return dst + 4;
+}
+
+// Merge runs of equal non-zero keys in a uN x vN mask (u fastest) into
+// rectangles, widest first along u, then as far along v as the whole run
+// repeats; each is cleared from the mask and handed to emit(u, v, w, h, key).
+// Without merge every key is its own 1 x 1 rectangle
+template <typename Emit>
+void mergeRects(uint32_t* mask, int uN, int vN, bool merge, Emit&& emit) {
+    for (int v = 0; v < vN; ++v) {
+        for (int u = 0; u < uN; ) {
+            uint32_t key = mask[v * uN + u];
+            if (!key) { ++u; continue; }
+            int w = 1;
+            while (merge && u + w < uN && mask[v * uN + u + w] == key) ++w;
+            int h = 1;
+            for (; merge && v + h < vN; ++h) {
+                const uint32_t* row = &mask[(v + h) * uN + u];
+                bool same = true;
+                for (int k = 0; k < w && same; ++k) same = row[k] == key;
+                if (!same) break;
+            }
+            for (int dv = 0; dv < h; ++dv)
+                std::fill_n(&mask[(v + dv) * uN + u], w, 0u);
+            emit(u, v, w, h, key);
+            u += w;
+        }
+    }
+}
+
+// Base color for most blocks (used on sides/bottom, and top when not special)
+std::array<float, 3> baseColorOf(BlockType t) {
+    switch (t) {
+        case BlockType::DIRT:   return {0.60f, 0.39f, 0.22f};
+        case BlockType::STONE:  return {0.58f, 0.58f, 0.58f};
+        case BlockType::WOOD:   return {0.64f, 0.32f, 0.16f};
+        case BlockType::LEAVES: return {0.40f, 0.70f, 0.30f};
+        default:                return {1.0f, 1.0f, 1.0f};
+    }
+}
+
+// Special top color (only for grass when no resource pack)
+std::array<float, 3> topColorOf(BlockType t, const ResourcePack* rp) {
+    if (t == BlockType::GRASS) {
+        if (!rp) return {0.55f, 0.85f, 0.35f};  // nice natural green tint
+        else     return {1.0f, 1.0f, 1.0f};     // let RP texture decide
+    }
+    return baseColorOf(t);
+}
+
+float typeIdOf(BlockType t) {
+    switch (t) {
+        case BlockType::GRASS:  return 0.0f;
+        case BlockType::DIRT:   return 1.0f;
+        case BlockType::STONE:  return 2.0f;
+        case BlockType::LEAVES: return 3.0f;
+        default:                return -1.0f;
+    }
+}
+
+} // namespace
+
+std::array<float, Mesh::MATERIAL_COUNT * 4> Mesh::materialPalette(const ResourcePack* rp) {
+    std::array<float, MATERIAL_COUNT * 4> pal{};
+    for (int t = 1; t < BLOCK_TYPE_COUNT; ++t) {
+        BlockType bt = static_cast<BlockType>(t);
+        // Side faces: use neutral color for grass (so overlay can shine)
+        std::array<float,3> sideCol = (bt == BlockType::GRASS) ? std::array<float,3>{1.0f,1.0f,1.0f} : baseColorOf(bt);
+        const std::array<float,3> cols[3] = {sideCol, baseColorOf(bt), topColorOf(bt, rp)};
+        for (int g = 0; g < 3; ++g) {
+            float* m = &pal[(t * 3 + g) * 4];
+            m[0] = cols[g][0]; m[1] = cols[g][1]; m[2] = cols[g][2];
+            m[3] = typeIdOf(bt);
+        }
+    }
+    return pal;
+}
+
+void Mesh::buildVertices(const Chunk* c, const Neighbors& neighbors, const ResourcePack* rp, MeshMode mode, std::vector<PackedVertex>& verts) {
+    SectionVertices sections;
+    buildSections(c, neighbors, rp, mode, 0xFF, sections);
+    verts.clear();
+    for (const auto& v : sections) verts.insert(verts.end(), v.begin(), v.end());
+}
+
+void Mesh::buildSections(const Chunk* c, const Neighbors& neighbors, const ResourcePack* rp, MeshMode mode,
+                         uint8_t sectionMask, SectionVertices& out, SectionConnectivity* connectivity, int lod,
+                         SectionQuadCounts* cutoutQuads) {
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        if (!(sectionMask & (1u << si))) continue;
+        out[si].clear();
+        if (cutoutQuads) (*cutoutQuads)[si] = 0;
+    }
 
     auto getTileForFace = [&](BlockType bt, int face) -> int {
         if (!rp) {
@@ -122,91 +307,539 @@ void Mesh::buildFromChunk(const Chunk* c, int cx, int cz, const ResourcePack* rp
         return (idx >= 0) ? idx : 0;
     };
 
-    for (int lx = 0; lx < CHUNK_SIZE; ++lx) {
-        for (int lz = 0; lz < CHUNK_SIZE; ++lz) {
-            for (int y = 0; y < CHUNK_HEIGHT; ++y) {
-                Block b = c->getBlock(lx, y, lz);
-                if (!b.isSolid()) continue;
-
-                BlockType bt = b.type;
-                float tid = typeIdOf(bt);
-
-                // Grass overlay only on sides
-                float overlayIdx = -1.0f;
-                if (bt == BlockType::GRASS && rp) {
-                    int oi = rp->getOverlayFor(bt);
-                    if (oi >= 0) {
-                        overlayIdx = static_cast<float>(oi);
+    // resolve every (block type, face) style once instead of per face;
+    // tiles and overlays are stored in 8 bits
+    FaceStyle styles[BLOCK_TYPE_COUNT][6];
+    for (int t = 1; t < BLOCK_TYPE_COUNT; ++t) {
+        BlockType bt = static_cast<BlockType>(t);
+        // Grass overlay only on sides
+        int overlayIdx = -1;
+        if (bt == BlockType::GRASS && rp) {
+            int oi = rp->getOverlayFor(bt);
+            if (oi >= 0 && oi < 255) overlayIdx = oi;
+        }
+        for (int face = 0; face < 6; ++face) {
+            FaceStyle& st = styles[t][face];
+            st.tile = std::min(getTileForFace(bt, face), 255);
+            st.overlay = face < 4 ? overlayIdx : -1;
+            st.material = materialOf(bt, face);
+        }
+    }
+    // Padded copy of the blocks and light the build reads: the sections being
+    // rebuilt, the ones above and below them, and the facing column of each
+    // neighbour (a missing neighbour reads as air under open sky). Rows y = -1
+    // and y = CHUNK_HEIGHT are never written: air, dark below and open sky
+    // above. A face takes the light of the cell in front of it. The copies and
+    // the vertex scratch are kept per thread, so a build does not allocate once
+    // warm.
+    static_assert(sizeof(Block) == 1, "rows are copied bytewise");
+    constexpr int PX = CHUNK_SIZE + 2, PY = CHUNK_HEIGHT + 2;
+    constexpr int STRIDE[3] = {1, PX * PX, PX}; // x, y, z
+    thread_local std::vector<uint8_t> types(PX * PX * PY, 0);
+    thread_local std::vector<uint8_t> lights = [] {
+        std::vector<uint8_t> l(PX * PX * PY, 0);
+        std::fill(l.end() - PX * PX, l.end(), static_cast<uint8_t>(0xF0));
+        return l;
+    }();
+    thread_local std::array<Block, SECTION_VOLUME> sectionBlocks;
+    thread_local std::vector<uint32_t> mask(CHUNK_SIZE * SECTION_HEIGHT);
+    thread_local std::vector<PackedVertex> scratch, cutScratch; // opaque quads, cutout quads
+    auto at = [](int x, int y, int z) { return ((y + 1) * PX + (z + 1)) * PX + (x + 1); };
+
+    uint8_t needed = sectionMask | static_cast<uint8_t>(sectionMask << 1) | static_cast<uint8_t>(sectionMask >> 1);
+
+    // at lod > 0, per side and per SKIRT_SPAN blocks along it: the lowest a
+    // loaded neighbour's top can be drawn at any level (see the coarse path)
+    constexpr int SKIRT_SPAN = 1 << MAX_LOD;
+    int skirt[4][CHUNK_SIZE / SKIRT_SPAN] = {};
+    // OPAQUE sections (bit per section) of all four neighbours
+    uint8_t sidesOpaque = 0xFF;
+
+    // neighbours first, each under its own read lock (never two chunk locks at once)
+    for (int n = 0; n < 4; ++n) {
+        const Chunk* nb = neighbors[n];
+        int facing = (n % 2 == 0) ? CHUNK_SIZE - 1 : 0; // the neighbour's column touching us
+        int outside = (n % 2 == 0) ? -1 : CHUNK_SIZE;    // where it lands in the padded copy
+        std::shared_lock<std::shared_mutex> nlk;
+        if (nb) nlk = std::shared_lock<std::shared_mutex>(nb->blockMutex);
+        uint8_t nbOpaque = 0;
+        for (int si = 0; nb && si < SECTION_COUNT; ++si)
+            if (nb->sectionFill[si] == SectionFill::OPAQUE) nbOpaque |= 1u << si;
+        sidesOpaque &= nbOpaque;
+        if (nb && lod > 0) {
+            // a cube below the top opaque block of all its columns is solid at
+            // every level, so the lowest such top over the strip a coarsest cube
+            // deep, rounded down to a cube, bounds the drawn surface. Leaves
+            // don't count: a sparse canopy merges to air
+            for (int span = 0; span < CHUNK_SIZE / SKIRT_SPAN; ++span) {
+                int low = CHUNK_HEIGHT;
+                for (int t = span * SKIRT_SPAN; t < (span + 1) * SKIRT_SPAN; ++t) {
+                    for (int depth = 0; depth < SKIRT_SPAN; ++depth) {
+                        int in = n % 2 == 0 ? facing - depth : facing + depth;
+                        int lx = n < 2 ? in : t, lz = n < 2 ? t : in;
+                        int top = nb->heightmap[lz * CHUNK_SIZE + lx];
+                        while (top >= 0 && nb->getBlockUnlocked(lx, top, lz).passesLight()) --top;
+                        low = std::min(low, top + 1);
+                    }
+                }
+                skirt[n][span] = low / SKIRT_SPAN * SKIRT_SPAN;
+            }
+        }
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            if (!(needed & (1u << si))) continue;
+            const ChunkSection* section = nb ? nb->sections[si].get() : nullptr;
+            for (int ly = 0; ly < SECTION_HEIGHT; ++ly) {
+                int y = si * SECTION_HEIGHT + ly;
+                for (int t = 0; t < CHUNK_SIZE; ++t) {
+                    uint8_t type = 0;
+                    if (section) {
+                        int idx = n < 2 ? ChunkSection::blockIndex(facing, ly, t) : ChunkSection::blockIndex(t, ly, facing);
+                        type = static_cast<uint8_t>(section->blocks.get(idx).type);
                     }
+                    int dst = n < 2 ? at(outside, y, t) : at(t, y, outside);
+                    types[dst] = type;
+                    lights[dst] = nb ? (n < 2 ? nb->lightAt(facing, y, t) : nb->lightAt(t, y, facing)) : 0xF0;
                 }
+            }
+        }
+    }
+
+    uint8_t occupied = 0, opaque = 0;
+    {
+        std::shared_lock<std::shared_mutex> lk(c->blockMutex);
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            const ChunkSection* section = c->sections[si].get();
+            if (section) occupied |= 1u << si;
+            if (c->sectionFill[si] == SectionFill::OPAQUE) opaque |= 1u << si;
+            if (!(needed & (1u << si))) continue;
+            if (section) section->blocks.getAll(sectionBlocks.data());
+            const SectionLight* light = c->light[si].get();
+            for (int ly = 0; ly < SECTION_HEIGHT; ++ly) {
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz) {
+                    uint8_t* row = &types[at(0, si * SECTION_HEIGHT + ly, lz)];
+                    if (section) std::memcpy(row, &sectionBlocks[ChunkSection::blockIndex(0, ly, lz)], CHUNK_SIZE);
+                    else std::memset(row, 0, CHUNK_SIZE);
+                    uint8_t* lightRow = &lights[at(0, si * SECTION_HEIGHT + ly, lz)];
+                    if (light) std::memcpy(lightRow, &light->levels[ChunkSection::blockIndex(0, ly, lz)], CHUNK_SIZE);
+                    else std::memset(lightRow, c->lightFill[si], CHUNK_SIZE);
+                }
+            }
+        }
+    }
 
-                float x0 = ox + lx;     float x1 = x0 + 1.0f;
-                float z0 = oz + lz;     float z1 = z0 + 1.0f;
-                float y0 = static_cast<float>(y);
-                float y1 = y0 + 1.0f;
-
-                // Bright placeholder – replace with proper AO later
-                float lightVal = 0.95f;
-
-                auto pushQuad = [&](float px0, float py0, float pz0,
-                                    float px1, float py1, float pz1,
-                                    float u0, float u1, float v0, float v1,
-                                    const std::array<float,3>& col,
-                                    float worldYForShader, float ovr) {
-                    pushVertex(verts, px0, py0, pz0, u0, v0, lightVal, col[0],col[1],col[2], tid, worldYForShader, ovr);
-                    pushVertex(verts, px1, py0, pz0, u1, v0, lightVal, col[0],col[1],col[2], tid, worldYForShader, ovr);
-                    pushVertex(verts, px1, py1, pz1, u1, v1, lightVal, col[0],col[1],col[2], tid, worldYForShader, ovr);
-                    pushVertex(verts, px0, py0, pz0, u0, v0, lightVal, col[0],col[1],col[2], tid, worldYForShader, ovr);
-                    pushVertex(verts, px1, py1, pz1, u1, v1, lightVal, col[0],col[1],col[2], tid, worldYForShader, ovr);
-                    pushVertex(verts, px0, py1, pz1, u0, v1, lightVal, col[0],col[1],col[2], tid, worldYForShader, ovr);
-                };
-
-                // ──────────────────────────────────────────────
-                // Side faces: use neutral color for grass (so overlay can shine)
-                std::array<float,3> sideCol = (bt == BlockType::GRASS) ? std::array<float,3>{1.0f,1.0f,1.0f} : baseColorOf(bt);
-
-                // -X
-                if (isAir(lx-1, y, lz)) {
-                    int tile = getTileForFace(bt, 0);
-                    float ti = tile * tileW;
-                    pushQuad(x0,y0,z0, x0,y1,z1, ti, ti + tileW, 0.0f, 1.0f, sideCol, y0, overlayIdx);
+    if (lod > 0) {
+        // merge k^3 cubes in place (the connectivity below sees them as the
+        // coarse path draws them); k divides the section height, so a cube
+        // never spans two sections and the padding stays as copied
+        const int k = 1 << lod;
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            if (!(needed & (1u << si))) continue;
+            const int y0 = si * SECTION_HEIGHT;
+            for (int by = y0; by < y0 + SECTION_HEIGHT; by += k) {
+                for (int bz = 0; bz < CHUNK_SIZE; bz += k) {
+                    for (int bx = 0; bx < CHUNK_SIZE; bx += k) {
+                        int solid = 0, top = 0;
+                        uint8_t sky = 0, glow = 0;
+                        for (int y = by + k - 1; y >= by; --y) {
+                            for (int z = bz; z < bz + k; ++z) {
+                                for (int x = bx, i = at(bx, y, z); x < bx + k; ++x, ++i) {
+                                    if (types[i]) {
+                                        ++solid;
+                                        if (!top) top = types[i];
+                                    }
+                                    sky = std::max<uint8_t>(sky, lights[i] & 0xF0);
+                                    glow = std::max<uint8_t>(glow, lights[i] & 0x0F);
+                                }
+                            }
+                        }
+                        uint8_t t = static_cast<uint8_t>(solid * 2 >= k * k * k ? top : 0);
+                        for (int y = by; y < by + k; ++y) {
+                            for (int z = bz; z < bz + k; ++z) {
+                                std::memset(&types[at(bx, y, z)], t, k);
+                                std::memset(&lights[at(bx, y, z)], sky | glow, k);
+                            }
+                        }
+                    }
                 }
-                // +X
-                if (isAir(lx+1, y, lz)) {
-                    int tile = getTileForFace(bt, 1);
-                    float ti = tile * tileW;
-                    pushQuad(x1,y0,z1, x1,y1,z0, ti, ti + tileW, 0.0f, 1.0f, sideCol, y0, overlayIdx);
+            }
+        }
+    }
+
+    // all-air sections are not allocated and emit nothing; neither do OPAQUE
+    // ones with OPAQUE sections on all six sides (at any level: their cubes are
+    // all solid, and the neighbours' surfaces are above them). The rows under
+    // y = 0 and over the top are air, so the lowest and highest never are
+    const uint8_t buried = opaque & static_cast<uint8_t>(opaque << 1) & static_cast<uint8_t>(opaque >> 1) & sidesOpaque;
+    const uint8_t build = sectionMask & occupied & ~buried;
+
+    if (connectivity) {
+        // flood-fill the cells that can be seen through (air and leaves) of each
+        // section; every region links all the section faces it touches
+        static_assert(SECTION_HEIGHT == CHUNK_SIZE, "sections are cubes");
+        thread_local std::vector<uint8_t> seen(SECTION_VOLUME);
+        thread_local std::vector<uint16_t> stack;
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            if (!(sectionMask & (1u << si))) continue;
+            // an OPAQUE section has no cell to see through
+            if (opaque & (1u << si)) {
+                (*connectivity)[si] = 0;
+                continue;
+            }
+            uint16_t links = 0;
+            if (!(build & (1u << si))) links = ALL_FACES_CONNECTED;
+            const int y0 = si * SECTION_HEIGHT;
+            std::fill(seen.begin(), seen.end(), 0);
+            for (int start = 0; start < SECTION_VOLUME && links != ALL_FACES_CONNECTED; ++start) {
+                if (seen[start] || !faceShows(0, types[at(start % CHUNK_SIZE, y0 + start / (CHUNK_SIZE * CHUNK_SIZE), start / CHUNK_SIZE % CHUNK_SIZE)])) continue;
+                unsigned faces = 0;
+                seen[start] = 1;
+                stack.assign(1, static_cast<uint16_t>(start));
+                while (!stack.empty()) {
+                    int cell = stack.back();
+                    stack.pop_back();
+                    // cell = (ly * CHUNK_SIZE + lz) * CHUNK_SIZE + lx, as ChunkSection::blockIndex
+                    int p[3] = {cell % CHUNK_SIZE, cell / (CHUNK_SIZE * CHUNK_SIZE), cell / CHUNK_SIZE % CHUNK_SIZE};
+                    const int step[3] = {1, CHUNK_SIZE * CHUNK_SIZE, CHUNK_SIZE};
+                    for (int face = 0; face < 6; ++face) {
+                        const FaceDir& d = FACE_DIRS[face];
+                        int n = p[d.normal] + d.sign;
+                        if (n < 0 || n >= CHUNK_SIZE) { faces |= 1u << face; continue; }
+                        int next = cell + d.sign * step[d.normal];
+                        if (seen[next]) continue;
+                        int q[3] = {p[0], p[1], p[2]};
+                        q[d.normal] = n;
+                        if (!faceShows(0, types[at(q[0], y0 + q[1], q[2])])) continue;
+                        seen[next] = 1;
+                        stack.push_back(static_cast<uint16_t>(next));
+                    }
                 }
-                // -Z
-                if (isAir(lx, y, lz-1)) {
-                    int tile = getTileForFace(bt, 2);
-                    float ti = tile * tileW;
-                    pushQuad(x1,y0,z0, x0,y1,z0, ti, ti + tileW, 0.0f, 1.0f, sideCol, y0, overlayIdx);
+                for (int a = 0; a < 6; ++a)
+                    for (int b = a + 1; b < 6; ++b)
+                        if ((faces >> a & 1u) && (faces >> b & 1u)) links |= 1u << facePairBit(a, b);
+            }
+            (*connectivity)[si] = links;
+        }
+    }
+
+    if (lod > 0) {
+        // Coarse path: the merged copy sampled once per cube into a grid of
+        // (16 / k)^3 cells a section, padded by one cell, and meshed as the
+        // GREEDY path does (NAIVE: one quad per cell face) with quads scaled by
+        // k. Grass sides are not keyed on y, so a merged side takes the snow
+        // blend of its bottom. Along a loaded neighbour the padding is solid up
+        // to its skirt height: border faces are kept only where they can show
+        // above the neighbour, closing the seam to whatever level it is drawn at.
+        // A missing neighbour leaves the border closed
+        const int k = 1 << lod, cn = CHUNK_SIZE / k, ch = CHUNK_HEIGHT / k, cp = cn + 2;
+        const int cstride[3] = {1, cp * cp, cp};
+        thread_local std::vector<uint8_t> ctypes, clights;
+        ctypes.resize(size_t(cp) * cp * (ch + 2));
+        clights.resize(ctypes.size());
+        auto cat = [&](int x, int y, int z) { return ((y + 1) * cp + (z + 1)) * cp + (x + 1); };
+        std::fill_n(&ctypes[cat(-1, -1, -1)], cp * cp, uint8_t(0));
+        std::fill_n(&clights[cat(-1, -1, -1)], cp * cp, uint8_t(0));
+        std::fill_n(&ctypes[cat(-1, ch, -1)], cp * cp, uint8_t(0));
+        std::fill_n(&clights[cat(-1, ch, -1)], cp * cp, uint8_t(0xF0));
+        for (int cy = 0; cy < ch; ++cy) {
+            if (!(needed & (1u << (cy * k / SECTION_HEIGHT)))) continue;
+            for (int cz = 0; cz < cn; ++cz) {
+                for (int cx = 0; cx < cn; ++cx) {
+                    ctypes[cat(cx, cy, cz)] = types[at(cx * k, cy * k, cz * k)];
+                    clights[cat(cx, cy, cz)] = lights[at(cx * k, cy * k, cz * k)];
                 }
-                // +Z
-                if (isAir(lx, y, lz+1)) {
-                    int tile = getTileForFace(bt, 3);
-                    float ti = tile * tileW;
-                    pushQuad(x0,y0,z1, x1,y1,z1, ti, ti + tileW, 0.0f, 1.0f, sideCol, y0, overlayIdx);
+            }
+            for (int n = 0; n < 4; ++n) {
+                int outside = (n % 2 == 0) ? -1 : CHUNK_SIZE;
+                for (int u = 0; u < cn; ++u) {
+                    uint8_t sky = 0, glow = 0;
+                    for (int y = cy * k; y < (cy + 1) * k; ++y) {
+                        for (int t = u * k; t < (u + 1) * k; ++t) {
+                            uint8_t l = lights[n < 2 ? at(outside, y, t) : at(t, y, outside)];
+                            sky = std::max<uint8_t>(sky, l & 0xF0);
+                            glow = std::max<uint8_t>(glow, l & 0x0F);
+                        }
+                    }
+                    bool covered = neighbors[n] && (cy + 1) * k <= skirt[n][u * k / SKIRT_SPAN];
+                    int ci = n < 2 ? cat(n == 0 ? -1 : cn, cy, u) : cat(u, cy, n == 2 ? -1 : cn);
+                    ctypes[ci] = covered ? static_cast<uint8_t>(BlockType::STONE) : 0;
+                    clights[ci] = sky | glow;
                 }
+            }
+        }
 
-                // Bottom
-                if (isAir(lx, y-1, lz)) {
-                    int tile = getTileForFace(bt, 4);
-                    float ti = tile * tileW;
-                    pushQuad(x0,y0,z0, x1,y0,z1, ti, ti + tileW, 0.0f, 1.0f, baseColorOf(bt), y0, -1.0f);
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            if (!(build & (1u << si))) continue;
+            const int lo[3] = {0, si * cn, 0};
+            const int hi[3] = {cn, (si + 1) * cn, cn};
+            size_t used = 0, usedCut = 0;
+            for (int face = 0; face < 6; ++face) {
+                const FaceDir& d = FACE_DIRS[face];
+                int su = cstride[d.u], sv = cstride[d.v];
+                int across = d.sign * cstride[d.normal];
+                for (int s = lo[d.normal]; s < hi[d.normal]; ++s) {
+                    int p[3];
+                    p[d.normal] = s;
+                    p[d.u] = lo[d.u];
+                    p[d.v] = lo[d.v];
+                    int sliceBase = cat(p[0], p[1], p[2]);
+                    size_t visible = 0;
+                    for (int v = 0; v < cn; ++v) {
+                        for (int u = 0, i = sliceBase + v * sv; u < cn; ++u, i += su) {
+                            uint32_t key = 0;
+                            int t = ctypes[i];
+                            if (t != 0 && faceShows(t, ctypes[i + across])) {
+                                key = static_cast<uint32_t>(t) | static_cast<uint32_t>(clights[i + across]) << 16;
+                                ++visible;
+                            }
+                            mask[v * cn + u] = key;
+                        }
+                    }
+                    if (!visible) continue;
+                    if (scratch.size() < used + visible * 4) scratch.resize((used + visible * 4) * 2);
+                    if (cutScratch.size() < usedCut + visible * 4) cutScratch.resize((usedCut + visible * 4) * 2);
+                    PackedVertex* dst = scratch.data() + used;
+                    PackedVertex* cut = cutScratch.data() + usedCut;
+                    mergeRects(mask.data(), cn, cn, mode != MeshMode::NAIVE, [&](int u, int v, int w, int h, uint32_t key) {
+                        int q[3];
+                        q[d.normal] = s;
+                        q[d.u] = lo[d.u] + u;
+                        q[d.v] = lo[d.v] + v;
+                        PackedVertex*& to = (key & 0xFF) == CUTOUT_TYPE ? cut : dst;
+                        to = emitQuad(to, face, q[0] * k, q[1] * k, q[2] * k, w * k, h * k, (key >> 16) & 0xFF,
+                                      styles[key & 0xFF][face], k);
+                    });
+                    used = static_cast<size_t>(dst - scratch.data());
+                    usedCut = static_cast<size_t>(cut - cutScratch.data());
                 }
+            }
+            out[si].assign(scratch.data(), scratch.data() + used);
+            out[si].insert(out[si].end(), cutScratch.data(), cutScratch.data() + usedCut);
+            if (cutoutQuads) (*cutoutQuads)[si] = static_cast<uint32_t>(usedCut / 4);
+        }
+        return;
+    }
 
-                // Top – special color for grass when no RP
-                if (isAir(lx, y+1, lz)) {
-                    int tile = getTileForFace(bt, 5);
-                    float ti = tile * tileW;
-                    auto topCol = topColorOf(bt);
-                    pushQuad(x0,y1,z1, x1,y1,z0, ti, ti + tileW, 0.0f, 1.0f, topCol, y1, -1.0f);
+    if (mode == MeshMode::NAIVE) {
+        // reference path: one quad per exposed face
+        const int offs[6] = {-STRIDE[0], STRIDE[0], -STRIDE[2], STRIDE[2], -STRIDE[1], STRIDE[1]};
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            if (!(build & (1u << si))) continue;
+            int y0 = si * SECTION_HEIGHT, y1 = y0 + SECTION_HEIGHT;
+            // prepass: count exposed faces so the section's list is sized once,
+            // with the cutout ones at the end
+            size_t faces = 0, cutoutFaces = 0;
+            for (int y = y0; y < y1; ++y)
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz)
+                    for (int lx = 0, i = at(0, y, lz); lx < CHUNK_SIZE; ++lx, ++i)
+                        if (int t = types[i])
+                            for (int face = 0; face < 6; ++face) {
+                                bool shows = faceShows(t, types[i + offs[face]]);
+                                faces += shows;
+                                cutoutFaces += shows && t == CUTOUT_TYPE;
+                            }
+            std::vector<PackedVertex>& verts = out[si];
+            verts.resize(faces * 4);
+            PackedVertex* dst = verts.data();
+            PackedVertex* cut = verts.data() + (faces - cutoutFaces) * 4;
+            for (int y = y0; y < y1; ++y) {
+                for (int lz = 0; lz < CHUNK_SIZE; ++lz) {
+                    for (int lx = 0, i = at(0, y, lz); lx < CHUNK_SIZE; ++lx, ++i) {
+                        int t = types[i];
+                        if (!t) continue;
+                        PackedVertex*& to = t == CUTOUT_TYPE ? cut : dst;
+                        for (int face = 0; face < 6; ++face)
+                            if (faceShows(t, types[i + offs[face]]))
+                                to = emitQuad(to, face, lx, y, lz, 1, 1, lights[i + offs[face]], styles[t][face]);
+                    }
                 }
             }
+            if (cutoutQuads) (*cutoutQuads)[si] = static_cast<uint32_t>(cutoutFaces);
         }
+        return;
     }
 
-    upload(verts);
-}
\ No newline at end of file
+    if (mode == MeshMode::BINARY) {
+        // Bitmask path: per section, 16-bit occupancy rows along x (one per y, z)
+        // and along z (one per y, x), including the padding layers, separately
+        // for opaque blocks and cutout ones. The faces of slice s seen along u
+        // are then whole-row operations on the rows at s and the rows in front of
+        // it: opaque & ~opaqueFront | cutout & ~(opaqueFront | cutoutFront).
+        // Each visible cell's key (the greedy path's mask value) is read once and
+        // its bit set in that key's own rows, so runs grow and repeat by mask
+        // tests. Merging walks set bits in the same order as the greedy path, so
+        // both emit the same quads
+        constexpr int ROWS = (SECTION_HEIGHT + 2) * PX;
+        thread_local std::vector<uint16_t> rowsX(ROWS * 2), rowsZ(ROWS * 2); // opaque rows, then cutout rows
+        thread_local std::vector<uint16_t> visible(CHUNK_SIZE);
+        thread_local std::vector<uint32_t> keys;        // distinct keys of the slice
+        thread_local std::vector<uint16_t> keyRows;     // CHUNK_SIZE rows per key
+        uint8_t cellKey[CHUNK_SIZE * CHUNK_SIZE];       // index into keys of each visible cell
+        static_assert(CHUNK_SIZE == 16, "rows are 16-bit masks");
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            if (!(build & (1u << si))) continue;
+            const int y0 = si * SECTION_HEIGHT;
+            // rowsX[(y - y0 + 1) * PX + z + 1]: bit x set if opaque (+ ROWS: if cutout);
+            // rowsZ likewise with x and z swapped
+            for (int py = 0; py < SECTION_HEIGHT + 2; ++py) {
+                for (int p = 0; p < PX; ++p) {
+                    uint32_t rx = 0, rz = 0, cx = 0, cz = 0;
+                    const uint8_t* row = &types[at(0, y0 - 1 + py, p - 1)];
+                    for (int k = 0; k < CHUNK_SIZE; ++k) {
+                        int tx = row[k], tz = types[at(p - 1, y0 - 1 + py, k)];
+                        rx |= static_cast<uint32_t>(tx != 0 && tx != CUTOUT_TYPE) << k;
+                        cx |= static_cast<uint32_t>(tx == CUTOUT_TYPE) << k;
+                        rz |= static_cast<uint32_t>(tz != 0 && tz != CUTOUT_TYPE) << k;
+                        cz |= static_cast<uint32_t>(tz == CUTOUT_TYPE) << k;
+                    }
+                    rowsX[py * PX + p] = static_cast<uint16_t>(rx);
+                    rowsX[ROWS + py * PX + p] = static_cast<uint16_t>(cx);
+                    rowsZ[py * PX + p] = static_cast<uint16_t>(rz);
+                    rowsZ[ROWS + py * PX + p] = static_cast<uint16_t>(cz);
+                }
+            }
+            size_t used = 0, usedCut = 0;
+
+            for (int face = 0; face < 6; ++face) {
+                const FaceDir& d = FACE_DIRS[face];
+                // X faces run along z (rowsZ indexed by y, x); Z and Y faces along x (rowsX by y, z)
+                const std::vector<uint16_t>& rows = d.normal == 0 ? rowsZ : rowsX;
+                int across = d.sign * STRIDE[d.normal];
+                for (int s = 0; s < (d.normal == 1 ? SECTION_HEIGHT : CHUNK_SIZE); ++s) {
+                    size_t count = 0;
+                    for (int v = 0; v < CHUNK_SIZE; ++v) {
+                        // (padded y, padded other) of the row at s and of the one in front
+                        int here = d.normal == 1 ? (s + 1) * PX + v + 1 : (v + 1) * PX + s + 1;
+                        int front = here + d.sign * (d.normal == 1 ? PX : 1);
+                        uint16_t bits = (rows[here] & ~rows[front]) |
+                                        (rows[ROWS + here] & ~(rows[front] | rows[ROWS + front]));
+                        visible[v] = bits;
+                        count += std::popcount(bits);
+                    }
+                    if (!count) continue;
+                    if (scratch.size() < used + count * 4) scratch.resize((used + count * 4) * 2);
+                    if (cutScratch.size() < usedCut + count * 4) cutScratch.resize((usedCut + count * 4) * 2);
+                    PackedVertex* dst = scratch.data() + used;
+                    PackedVertex* cut = cutScratch.data() + usedCut;
+
+                    // bucket the visible cells by key; neighbouring cells mostly share one
+                    keys.clear();
+                    size_t k = 0;
+                    for (int v = 0; v < CHUNK_SIZE; ++v) {
+                        for (uint32_t bits = visible[v]; bits; bits &= bits - 1) {
+                            int u = std::countr_zero(bits);
+                            int q[3];
+                            q[d.normal] = d.normal == 1 ? y0 + s : s;
+                            q[d.u] = u;
+                            q[d.v] = d.v == 1 ? y0 + v : v;
+                            int i = at(q[0], q[1], q[2]);
+                            int t = types[i];
+                            uint32_t key = static_cast<uint32_t>(t) | static_cast<uint32_t>(lights[i + across]) << 16;
+                            if (t == static_cast<int>(BlockType::GRASS)) key |= static_cast<uint32_t>(q[1] + 1) << 8;
+                            if (k >= keys.size() || keys[k] != key) {
+                                k = std::find(keys.begin(), keys.end(), key) - keys.begin();
+                                if (k == keys.size()) {
+                                    keys.push_back(key);
+                                    if (keyRows.size() < keys.size() * CHUNK_SIZE) keyRows.resize(keys.size() * CHUNK_SIZE * 2);
+                                    std::fill_n(&keyRows[k * CHUNK_SIZE], CHUNK_SIZE, uint16_t(0));
+                                }
+                            }
+                            keyRows[k * CHUNK_SIZE + v] |= static_cast<uint16_t>(1u << u);
+                            cellKey[v * CHUNK_SIZE + u] = static_cast<uint8_t>(k);
+                        }
+                    }
+                    for (int v = 0; v < CHUNK_SIZE; ++v) {
+                        while (visible[v]) {
+                            int u = std::countr_zero(visible[v]);
+                            uint32_t key = keys[cellKey[v * CHUNK_SIZE + u]];
+                            uint16_t* rows = &keyRows[cellKey[v * CHUNK_SIZE + u] * CHUNK_SIZE];
+                            int w = std::countr_one(static_cast<uint32_t>(rows[v] >> u));
+                            uint16_t run = static_cast<uint16_t>(((1u << w) - 1u) << u);
+                            int h = 1;
+                            while (v + h < CHUNK_SIZE && (rows[v + h] & run) == run) ++h;
+                            for (int dv = 0; dv < h; ++dv) {
+                                rows[v + dv] &= static_cast<uint16_t>(~run);
+                                visible[v + dv] &= static_cast<uint16_t>(~run);
+                            }
+
+                            int q[3];
+                            q[d.normal] = d.normal == 1 ? y0 + s : s;
+                            q[d.u] = u;
+                            q[d.v] = d.v == 1 ? y0 + v : v;
+                            PackedVertex*& to = (key & 0xFF) == CUTOUT_TYPE ? cut : dst;
+                            to = emitQuad(to, face, q[0], q[1], q[2], w, h, (key >> 16) & 0xFF, styles[key & 0xFF][face]);
+                        }
+                    }
+                    used = static_cast<size_t>(dst - scratch.data());
+                    usedCut = static_cast<size_t>(cut - cutScratch.data());
+                }
+            }
+            out[si].assign(scratch.data(), scratch.data() + used);
+            out[si].insert(out[si].end(), cutScratch.data(), cutScratch.data() + usedCut);
+            if (cutoutQuads) (*cutoutQuads)[si] = static_cast<uint32_t>(usedCut / 4);
+        }
+        return;
+    }
+
+    // greedy path: for every face direction and slice of each section build a
+    // mask of visible faces and merge equal neighbours into rectangles (never
+    // across sections, so each can be rebuilt on its own). The visible-face
+    // count of a slice bounds its quads, which sizes the scratch before writing.
+    // Cutout quads are collected apart and appended after the opaque ones
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        if (!(build & (1u << si))) continue;
+        const int lo[3] = {0, si * SECTION_HEIGHT, 0};
+        const int hi[3] = {CHUNK_SIZE, (si + 1) * SECTION_HEIGHT, CHUNK_SIZE};
+        size_t used = 0, usedCut = 0;
+
+        for (int face = 0; face < 6; ++face) {
+            const FaceDir& d = FACE_DIRS[face];
+            int uLo = lo[d.u], vLo = lo[d.v];
+            int uN = hi[d.u] - uLo, vN = hi[d.v] - vLo;
+            int su = STRIDE[d.u], sv = STRIDE[d.v];
+            int across = d.sign * STRIDE[d.normal];
+            for (int s = lo[d.normal]; s < hi[d.normal]; ++s) {
+                // mask key: block type, the light in front of the face (merged faces
+                // must be lit alike), and for grass y + 1 because the shader's snow
+                // blend uses the per-quad worldY
+                int p[3];
+                p[d.normal] = s;
+                p[d.u] = uLo;
+                p[d.v] = vLo;
+                int sliceBase = at(p[0], p[1], p[2]);
+                size_t visible = 0;
+                for (int v = 0; v < vN; ++v) {
+                    int y = d.normal == 1 ? s : vLo + v;
+                    for (int u = 0, i = sliceBase + v * sv; u < uN; ++u, i += su) {
+                        uint32_t key = 0;
+                        int t = types[i];
+                        if (t != 0 && faceShows(t, types[i + across])) {
+                            key = static_cast<uint32_t>(t) | static_cast<uint32_t>(lights[i + across]) << 16;
+                            if (t == static_cast<int>(BlockType::GRASS)) key |= static_cast<uint32_t>(y + 1) << 8;
+                            ++visible;
+                        }
+                        mask[v * uN + u] = key;
+                    }
+                }
+                if (!visible) continue;
+                if (scratch.size() < used + visible * 4) scratch.resize((used + visible * 4) * 2);
+                if (cutScratch.size() < usedCut + visible * 4) cutScratch.resize((usedCut + visible * 4) * 2);
+                PackedVertex* dst = scratch.data() + used;
+                PackedVertex* cut = cutScratch.data() + usedCut;
+
+                mergeRects(mask.data(), uN, vN, true, [&](int u, int v, int w, int h, uint32_t key) {
+                    int q[3];
+                    q[d.normal] = s;
+                    q[d.u] = uLo + u;
+                    q[d.v] = vLo + v;
+                    PackedVertex*& to = (key & 0xFF) == CUTOUT_TYPE ? cut : dst;
+                    to = emitQuad(to, face, q[0], q[1], q[2], w, h, (key >> 16) & 0xFF, styles[key & 0xFF][face]);
+                });
+                used = static_cast<size_t>(dst - scratch.data());
+                usedCut = static_cast<size_t>(cut - cutScratch.data());
+            }
+        }
+        out[si].assign(scratch.data(), scratch.data() + used);
+        out[si].insert(out[si].end(), cutScratch.data(), cutScratch.data() + usedCut);
+        if (cutoutQuads) (*cutoutQuads)[si] = static_cast<uint32_t>(usedCut / 4);
+    }
+}
@@ -1,15 +1,139 @@
 #pragma once
 #include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <glad/glad.h>
 #include "chunk.h"
+#include "pool.h"
+#include "mesh_arena.h"
+#include "math.h"
+
+// how buildVertices turns blocks into quads
+enum class MeshMode {
+    NAIVE,   // one quad per exposed face; kept as the reference for correctness checks
+    GREEDY,  // coplanar faces with the same look merged into larger rectangles
+    BINARY,  // GREEDY's output, computed on per-row occupancy bitmasks
+};
+
+// 8-byte chunk vertex, decoded in shaders/voxel.vert:
+//   lo: x 5 | y 8 | z 5 | face 3 | block light 4 | sky light 4   (chunk-local corner, 0..16 / 0..128)
+//   hi: tile 8 | overlay+1 8 | material 8 | worldY 8
+struct PackedVertex {
+    uint32_t lo = 0, hi = 0;
+};
+static_assert(sizeof(PackedVertex) == 8, "PackedVertex must stay 8 bytes");
+
+using SectionVertices = std::array<std::vector<PackedVertex>, SECTION_COUNT>;
+// a mesh job's sections as the GL thread receives them: shared with the
+// job's SectionMeshCache and never written again once handed over
+using SharedSectionVertices = std::array<std::shared_ptr<const std::vector<PackedVertex>>, SECTION_COUNT>;
+using SectionVersions = std::array<uint32_t, SECTION_COUNT>;
+// quads per section; for cutout counts, the trailing ones of its vertex list
+using SectionQuadCounts = std::array<uint32_t, SECTION_COUNT>;
+
+// Which faces of each section are linked through non-solid blocks: one bit per
+// pair of faces (-X, +X, -Z, +Z, -Y, +Y, see facePairBit). Empty sections link
+// everything; OcclusionCuller only walks from one section to the next through
+// linked faces.
+using SectionConnectivity = std::array<uint16_t, SECTION_COUNT>;
+constexpr uint16_t ALL_FACES_CONNECTED = 0x7FFF;
+constexpr int facePairBit(int a, int b) {
+    return a < b ? a * (11 - a) / 2 + b - a - 1 : b * (11 - b) / 2 + a - b - 1;
+}
+
+// CPU vertices of a chunk, one list per section. Mesh jobs rebuild only the
+// sections marked in Chunk::dirtySections and give each rebuilt one a new
+// version; the GL thread re-uploads only sections whose version it hasn't seen.
+// Results share the lists instead of copying them: a rebuilt section goes into
+// a list no pending result holds (the old one is reused once the GL thread is
+// done with it), so a warm build still allocates nothing.
+struct SectionMeshCache {
+    std::mutex mutex; // held for a whole build, so builds of one chunk never interleave
+    std::array<std::shared_ptr<std::vector<PackedVertex>>, SECTION_COUNT> sections;
+    SectionVersions versions{}; // 0: never built
+    SectionQuadCounts cutoutQuads{};
+    SectionConnectivity connectivity = filledConnectivity();
+    int lod = 0; // level the sections were built at; a different level rebuilds them all
+    uint32_t nextVersion = 1;
+
+    static SectionConnectivity filledConnectivity() {
+        SectionConnectivity c;
+        c.fill(ALL_FACES_CONNECTED);
+        return c;
+    }
+};
 
 class Mesh {
 public:
-    GLuint vao = 0, vbo = 0;
-    size_t vertexCount = 0;
-    Mesh();
+    // size of the material palette uniform (rgb tint + type id per entry) in voxel.vert
+    static constexpr int MATERIAL_COUNT = 32;
+    // coarsest level of detail: 8x8x8 blocks meshed as one
+    static constexpr int MAX_LOD = 3;
+
+    size_t vertexCount = 0;       // 4 per quad, drawn through quadIndexBuffer()
+    int originX = 0, originZ = 0; // world position of the chunk's corner, set per draw
+
+    // each non-empty section lives in its own range of the shared MeshArena; a
+    // changed section gives its range back and is written into a new one
+    std::array<MeshArena::Range, SECTION_COUNT> ranges{};
+    // trailing quads of each range that belong to the cutout (leaves) pass
+    std::array<uint32_t, SECTION_COUNT> cutoutQuads{};
+    SectionVersions uploadedVersions{};
+    // of the uploaded sections; all linked until a build says otherwise
+    SectionConnectivity connectivity = SectionMeshCache::filledConnectivity();
+
+    Mesh() = default;
     ~Mesh();
-    void upload(const std::vector<float>& data);
-    void draw() const;
-    void buildFromChunk(const Chunk* c, int cx, int cz, const class ResourcePack* rp = nullptr);
+    // upload the sections whose version differs from what the arena holds (GL thread only)
+    void uploadSections(const SharedSectionVertices& sections, const SectionVersions& versions,
+                        const SectionQuadCounts& cutouts);
+    // give every section's range back to the arena, e.g. when the chunk is unloaded
+    // or a pooled mesh gets a new chunk (GL thread only)
+    void clear();
+    // sections queued and skipped by draw, summed over a frame
+    struct DrawCounts {
+        uint32_t drawn = 0, culled = 0, occluded = 0;
+    };
+    // queue the sections in visibleSections (bit per section, see OcclusionCuller)
+    // that are inside the view frustum for this frame's MeshArena::draw, their
+    // opaque quads and cutout quads into the matching pass
+    void draw(const Math::Frustum& frustum, uint8_t visibleSections, DrawCounts& counts) const;
+    // the chunks bordering the one being meshed, in the order -X, +X, -Z, +Z;
+    // null where a neighbour is not loaded (its side is treated as air)
+    using Neighbors = std::array<const Chunk*, 4>;
+
+    // CPU meshing: refills the sections in sectionMask with chunk-local vertices
+    // and leaves the others alone; faces against solid neighbour blocks are
+    // culled. Each section lists its cutout (leaves) quads last; when
+    // cutoutQuads is given, their counts are stored there, and when
+    // connectivity is given, the same sections' entries are recomputed too.
+    // At lod > 0 the blocks are merged into cubes of 2^lod (solid if at least
+    // half is, with the type of the topmost solid block, lit by the brightest)
+    // and meshed as a grid of such cubes with scaled quads. Neighbours are not
+    // culled against there: the border only drops faces below the lowest a
+    // neighbour's surface is drawn at any level, leaving skirts that close the
+    // seam to it. Makes no GL calls, so it runs on the job pool and the GL
+    // thread only uploads the result
+    static void buildSections(const Chunk* c, const Neighbors& neighbors, const class ResourcePack* rp, MeshMode mode,
+                              uint8_t sectionMask, SectionVertices& out, SectionConnectivity* connectivity = nullptr,
+                              int lod = 0, SectionQuadCounts* cutoutQuads = nullptr);
+    // the whole chunk in one list (benchmarks and checks)
+    static void buildVertices(const Chunk* c, const Neighbors& neighbors, const class ResourcePack* rp, MeshMode mode, std::vector<PackedVertex>& out);
+    // colors and type ids the packed material indices refer to, for the materials uniform
+    static std::array<float, MATERIAL_COUNT * 4> materialPalette(const class ResourcePack* rp);
+
+    // index buffer shared by all chunk meshes, grown to at least `quads` quads (GL thread only)
+    static GLuint quadIndexBuffer(size_t quads);
+
+    // pooled meshes hold no arena ranges (clear() them before release); trim the
+    // pool on the GL thread only
+    static ObjectPool<Mesh>& pool();
+    // hand a mesh to the GL thread for release, from any thread (e.g. a chunk
+    // destroyed by a job); releasePending() clears and pools it
+    static void releaseLater(Mesh* mesh);
+    // clear and pool the meshes handed over by releaseLater (GL thread only)
+    static void releasePending();
 };
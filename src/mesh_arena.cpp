@@ -0,0 +1,201 @@
+#include "mesh_arena.h"
+#include <algorithm>
+#include "mesh.h"
+
+namespace {
+// starting size: 256k quads (8 MiB), about a 12-chunk radius of greedy meshes
+constexpr uint32_t INITIAL_CAPACITY_QUADS = 1u << 18;
+constexpr GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+constexpr size_t QUAD_BYTES = 4 * sizeof(PackedVertex);
+} // namespace
+
+MeshArena& MeshArena::get() {
+    static MeshArena arena;
+    return arena;
+}
+
+void MeshArena::insertFree(uint32_t first, uint32_t quads) {
+    if (!quads) return;
+    auto next = freeList.lower_bound(first);
+    // merge with the range ending where this one starts, then with the one it runs into
+    if (next != freeList.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == first) {
+            first = prev->first;
+            quads += prev->second;
+            freeList.erase(prev);
+        }
+    }
+    if (next != freeList.end() && first + quads == next->first) {
+        quads += next->second;
+        freeList.erase(next);
+    }
+    freeList.emplace(first, quads);
+}
+
+void MeshArena::collect() {
+    while (!pending.empty()) {
+        GLenum r = glClientWaitSync(pending.front().fence, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(pending.front().fence);
+        for (const auto& [first, quads] : pending.front().ranges) insertFree(first, quads);
+        pending.pop_front();
+    }
+}
+
+PackedVertex* MeshArena::allocate(Range& owner, uint32_t quads) {
+    release(owner);
+    if (!quads) return nullptr;
+    if (!vbo) relayout(std::max(INITIAL_CAPACITY_QUADS, quads));
+    collect();
+
+    auto fit = [&] {
+        for (auto it = freeList.begin(); it != freeList.end(); ++it)
+            if (it->second >= quads) return it;
+        return freeList.end();
+    };
+    auto it = fit();
+    if (it == freeList.end()) {
+        // pack the live ranges to the front; grow when they would leave less than
+        // a quarter free, so compactions stay rare as the loaded area grows
+        uint64_t need = uint64_t(usedQuads) + quads;
+        uint64_t newCapacity = capacity;
+        while (need + need / 3 > newCapacity) newCapacity *= 2;
+        relayout(static_cast<uint32_t>(newCapacity));
+        it = fit();
+    }
+
+    uint32_t first = it->first, left = it->second - quads;
+    freeList.erase(it);
+    insertFree(first + quads, left);
+
+    owner.first = first;
+    owner.quads = quads;
+    owners.insert(&owner);
+    usedQuads += quads;
+    if (quads > maxRangeQuads) {
+        maxRangeQuads = quads;
+        Mesh::quadIndexBuffer(quads); // every command draws from index 0
+    }
+    return mapped + size_t(first) * 4;
+}
+
+void MeshArena::release(Range& owner) {
+    if (!owner.quads) return;
+    owners.erase(&owner);
+    freedThisFrame.emplace_back(owner.first, owner.quads);
+    usedQuads -= owner.quads;
+    owner = {};
+}
+
+void MeshArena::relayout(uint32_t newCapacity) {
+    GLuint next = 0;
+    glGenBuffers(1, &next);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, next);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size_t(newCapacity) * QUAD_BYTES, nullptr, MAP_FLAGS);
+    PackedVertex* nextMapped = static_cast<PackedVertex*>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size_t(newCapacity) * QUAD_BYTES, MAP_FLAGS));
+
+    // live ranges keep their order; the GPU copies them, so nothing is read back
+    uint32_t cursor = 0;
+    if (vbo) {
+        std::vector<Range*> live(owners.begin(), owners.end());
+        std::sort(live.begin(), live.end(), [](const Range* a, const Range* b) { return a->first < b->first; });
+        glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+        for (Range* r : live) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, size_t(r->first) * QUAD_BYTES,
+                                size_t(cursor) * QUAD_BYTES, size_t(r->quads) * QUAD_BYTES);
+            r->first = cursor;
+            cursor += r->quads;
+        }
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        // draws still using the old storage finish first; GL defers the delete
+        glDeleteBuffers(1, &vbo);
+        ++relayouts;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // freed and pending ranges were in the old buffer: everything past the live data is free
+    for (Pending& p : pending) glDeleteSync(p.fence);
+    pending.clear();
+    freedThisFrame.clear();
+    freeList.clear();
+    insertFree(cursor, newCapacity - cursor);
+
+    vbo = next;
+    mapped = nextMapped;
+    capacity = newCapacity;
+
+    if (!vao) {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &commandBuffer);
+        glGenBuffers(1, &originBuffer);
+    }
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Mesh::quadIndexBuffer(0));
+    // layout: one uvec2 per vertex, unpacked in voxel.vert
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, sizeof(PackedVertex), (void*)(0));
+    // chunk origin, one per command (baseInstance selects it)
+    glBindBuffer(GL_ARRAY_BUFFER, originBuffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(0));
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshArena::add(Pass pass, const Range& range, uint32_t offset, uint32_t quads, int originX, int originZ) {
+    if (quads) queued[pass].push_back({&range, offset, quads, originX, originZ});
+}
+
+void MeshArena::draw(Pass pass) {
+    commands.clear();
+    origins.clear();
+    for (const Queued& q : queued[pass]) {
+        const Range& r = *q.range;
+        if (q.offset + q.quads > r.quads) continue; // released or replaced since it was queued
+        GLuint instance = static_cast<GLuint>(commands.size());
+        commands.push_back({q.quads * 6, 1, 0, static_cast<GLint>((r.first + q.offset) * 4), instance});
+        origins.insert(origins.end(), {static_cast<float>(q.originX), 0.0f, static_cast<float>(q.originZ)});
+    }
+    queued[pass].clear();
+    if (pass == OPAQUE) lastDrawCommands = 0;
+    lastDrawCommands += static_cast<uint32_t>(commands.size());
+
+    if (!commands.empty()) {
+        // the draw list is rebuilt every frame; orphaning keeps it off the GPU's critical path
+        glBindBuffer(GL_ARRAY_BUFFER, originBuffer);
+        glBufferData(GL_ARRAY_BUFFER, origins.size() * sizeof(float), origins.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_STREAM_DRAW);
+
+        glBindVertexArray(vao);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands.size()), 0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // ranges freed up to now are reusable once everything issued so far has run
+    if (!freedThisFrame.empty()) {
+        pending.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(freedThisFrame)});
+        freedThisFrame.clear();
+    }
+    collect();
+}
+
+MeshArena::Stats MeshArena::stats() const {
+    Stats s;
+    s.capacityQuads = capacity;
+    s.usedQuads = usedQuads;
+    for (const Pending& p : pending)
+        for (const auto& r : p.ranges) s.pendingQuads += r.second;
+    for (const auto& r : freedThisFrame) s.pendingQuads += r.second;
+    s.freeRanges = freeList.size();
+    s.relayouts = relayouts;
+    s.lastDrawCommands = lastDrawCommands;
+    return s;
+}
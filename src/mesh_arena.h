@@ -0,0 +1,106 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+struct PackedVertex; // mesh.h
+
+// One persistently mapped vertex buffer holding the quads of every chunk
+// section, and the draw lists that render them with one
+// glMultiDrawElementsIndirect per pass and frame. Each command draws one range through
+// the shared quad index buffer; its chunk origin is an instanced attribute
+// picked by the command's baseInstance. Space is handed out in whole quads
+// from a first-fit free list. A freed range is only reused once the GPU has
+// finished the draws issued before it was freed (a fence per frame), so CPU
+// writes never race draws in flight. When no free range fits, the live ranges
+// are copied GPU-side into a fresh buffer, packed to the front (compaction)
+// and grown if needed; owners' ranges are updated in place. GL thread only.
+class MeshArena {
+public:
+    // a run of quads in the arena, owned by a Mesh section; first moves on compaction
+    struct Range {
+        uint32_t first = 0, quads = 0;
+    };
+
+    struct Stats {
+        uint32_t capacityQuads = 0;
+        uint32_t usedQuads = 0;      // held by live ranges
+        uint32_t pendingQuads = 0;   // freed, waiting for the GPU
+        size_t freeRanges = 0;
+        uint64_t relayouts = 0;      // compactions / growths so far
+        uint32_t lastDrawCommands = 0; // over both passes of the last frame
+    };
+
+    // opaque quads first, then alpha-tested ones with their own shader; each
+    // pass is drawn in the order it was queued (front to back from main)
+    enum Pass { OPAQUE, CUTOUT, PASS_COUNT };
+
+    static MeshArena& get();
+
+    // space for `quads` quads, to be written (4 vertices each) through the returned
+    // pointer; the range is recorded in owner, which must stay at the same address
+    // until it is released
+    PackedVertex* allocate(Range& owner, uint32_t quads);
+    // give the range back (reusable once the draws issued so far are done)
+    void release(Range& owner);
+
+    // queue `quads` quads starting `offset` quads into a range for this frame's
+    // draw of a pass, at the chunk corner originX, originZ; the range is read
+    // again in draw(), so it may still move or be released before
+    void add(Pass pass, const Range& range, uint32_t offset, uint32_t quads, int originX, int originZ);
+    // draw everything queued for the pass since its last draw in one indirect
+    // multi-draw (the pass's shader already bound)
+    void draw(Pass pass);
+
+    Stats stats() const;
+
+private:
+    MeshArena() = default;
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    // GL objects are left to context teardown, like Mesh::quadIndexBuffer
+    GLuint vao = 0, vbo = 0, commandBuffer = 0, originBuffer = 0;
+    PackedVertex* mapped = nullptr;
+    uint32_t capacity = 0; // in quads
+
+    std::map<uint32_t, uint32_t> freeList; // first -> quads, coalesced
+    std::vector<std::pair<uint32_t, uint32_t>> freedThisFrame;
+    struct Pending {
+        GLsync fence;
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    };
+    std::deque<Pending> pending;
+    std::unordered_set<Range*> owners;
+    uint32_t usedQuads = 0;
+    uint64_t relayouts = 0;
+
+    // per-frame draw list: the queued ranges, turned into one command and one
+    // chunk origin each when drawn
+    struct Queued {
+        const Range* range;
+        uint32_t offset, quads;
+        int originX, originZ;
+    };
+    std::vector<Queued> queued[PASS_COUNT];
+    struct DrawCommand {
+        GLuint count, instanceCount, firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+    std::vector<DrawCommand> commands;
+    std::vector<float> origins; // xyz per command, voxel.vert's aChunkOrigin
+    uint32_t lastDrawCommands = 0;
+    uint32_t maxRangeQuads = 0;
+
+    void insertFree(uint32_t first, uint32_t quads);
+    // move ranges whose fence has signaled onto the free list
+    void collect();
+    // copy every live range to the front of a new buffer of newCapacity quads
+    void relayout(uint32_t newCapacity);
+};
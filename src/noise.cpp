@@ -0,0 +1,186 @@
+#include "noise.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CUBICA_NOISE_X86 1
+#endif
+
+namespace Noise {
+
+const float* gradientTable() {
+    static const std::vector<float> table = [] {
+        std::vector<float> t(GRADIENT_COUNT * 2);
+        for (uint32_t i = 0; i < GRADIENT_COUNT; ++i) {
+            // exactly the angle and calls the per-sample grad() used to make
+            float angle = i * (2.0f * 3.14159265358979323846f / 65536.0f);
+            t[i * 2] = std::cos(angle);
+            t[i * 2 + 1] = std::sin(angle);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+#ifdef CUBICA_NOISE_X86
+
+// The lane code mirrors perlin2d() operation for operation (same products,
+// same association, no FMA) so every lane rounds exactly like the scalar path.
+
+static inline __m128i mullo32Sse2(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i hashSse2(__m128i ix, __m128i iy) {
+    __m128i h = _mm_add_epi32(mullo32Sse2(ix, _mm_set1_epi32(374761393)), mullo32Sse2(iy, _mm_set1_epi32(668265263)));
+    return mullo32Sse2(_mm_xor_si128(h, _mm_srli_epi32(h, 13)), _mm_set1_epi32(1274126177));
+}
+
+static inline __m128 gradSse2(const float* table, __m128i ix, __m128i iy, __m128 x, __m128 y) {
+    alignas(16) uint32_t idx[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_and_si128(hashSse2(ix, iy), _mm_set1_epi32(GRADIENT_COUNT - 1)));
+    __m128 gx = _mm_setr_ps(table[idx[0] * 2], table[idx[1] * 2], table[idx[2] * 2], table[idx[3] * 2]);
+    __m128 gy = _mm_setr_ps(table[idx[0] * 2 + 1], table[idx[1] * 2 + 1], table[idx[2] * 2 + 1], table[idx[3] * 2 + 1]);
+    return _mm_add_ps(_mm_mul_ps(gx, x), _mm_mul_ps(gy, y));
+}
+
+static inline __m128 fadeSse2(__m128 t) {
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+static inline __m128 lerpSse2(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+static int perlinSse2(const float* xs, const float* ys, float* out, int n) {
+    const float* table = gradientTable();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128 onef = _mm_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(xs + i);
+        __m128 y = _mm_loadu_ps(ys + i);
+        // floor via truncation, stepping down where truncation rounded up (negatives)
+        __m128i xt = _mm_cvttps_epi32(x);
+        __m128i yt = _mm_cvttps_epi32(y);
+        __m128i xi = _mm_add_epi32(xt, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(xt), x)));
+        __m128i yi = _mm_add_epi32(yt, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(yt), y)));
+        __m128 xf = _mm_sub_ps(x, _mm_cvtepi32_ps(xi));
+        __m128 yf = _mm_sub_ps(y, _mm_cvtepi32_ps(yi));
+        __m128i xi1 = _mm_add_epi32(xi, one);
+        __m128i yi1 = _mm_add_epi32(yi, one);
+        __m128 xf1 = _mm_sub_ps(xf, onef);
+        __m128 yf1 = _mm_sub_ps(yf, onef);
+
+        __m128 n00 = gradSse2(table, xi, yi, xf, yf);
+        __m128 n10 = gradSse2(table, xi1, yi, xf1, yf);
+        __m128 n01 = gradSse2(table, xi, yi1, xf, yf1);
+        __m128 n11 = gradSse2(table, xi1, yi1, xf1, yf1);
+
+        __m128 u = fadeSse2(xf);
+        __m128 v = fadeSse2(yf);
+        __m128 nxy = lerpSse2(lerpSse2(n00, n10, u), lerpSse2(n01, n11, u), v);
+        _mm_storeu_ps(out + i, _mm_mul_ps(nxy, _mm_set1_ps(1.41421356237f)));
+    }
+    return i;
+}
+
+#define CUBICA_AVX2 __attribute__((target("avx2")))
+
+CUBICA_AVX2 static inline __m256i hashAvx2(__m256i ix, __m256i iy) {
+    __m256i h = _mm256_add_epi32(_mm256_mullo_epi32(ix, _mm256_set1_epi32(374761393)),
+                                 _mm256_mullo_epi32(iy, _mm256_set1_epi32(668265263)));
+    return _mm256_mullo_epi32(_mm256_xor_si256(h, _mm256_srli_epi32(h, 13)), _mm256_set1_epi32(1274126177));
+}
+
+CUBICA_AVX2 static inline __m256 gradAvx2(const float* table, __m256i ix, __m256i iy, __m256 x, __m256 y) {
+    // gather the interleaved (cos, sin) pair of each lane's gradient
+    __m256i idx = _mm256_slli_epi32(_mm256_and_si256(hashAvx2(ix, iy), _mm256_set1_epi32(GRADIENT_COUNT - 1)), 1);
+    __m256 gx = _mm256_i32gather_ps(table, idx, 4);
+    __m256 gy = _mm256_i32gather_ps(table + 1, idx, 4);
+    return _mm256_add_ps(_mm256_mul_ps(gx, x), _mm256_mul_ps(gy, y));
+}
+
+CUBICA_AVX2 static inline __m256 fadeAvx2(__m256 t) {
+    __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+CUBICA_AVX2 static inline __m256 lerpAvx2(__m256 a, __m256 b, __m256 t) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+CUBICA_AVX2 static int perlinAvx2(const float* xs, const float* ys, float* out, int n) {
+    const float* table = gradientTable();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 onef = _mm256_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        __m256 y = _mm256_loadu_ps(ys + i);
+        __m256i xi = _mm256_cvttps_epi32(_mm256_floor_ps(x));
+        __m256i yi = _mm256_cvttps_epi32(_mm256_floor_ps(y));
+        __m256 xf = _mm256_sub_ps(x, _mm256_cvtepi32_ps(xi));
+        __m256 yf = _mm256_sub_ps(y, _mm256_cvtepi32_ps(yi));
+        __m256i xi1 = _mm256_add_epi32(xi, one);
+        __m256i yi1 = _mm256_add_epi32(yi, one);
+        __m256 xf1 = _mm256_sub_ps(xf, onef);
+        __m256 yf1 = _mm256_sub_ps(yf, onef);
+
+        __m256 n00 = gradAvx2(table, xi, yi, xf, yf);
+        __m256 n10 = gradAvx2(table, xi1, yi, xf1, yf);
+        __m256 n01 = gradAvx2(table, xi, yi1, xf, yf1);
+        __m256 n11 = gradAvx2(table, xi1, yi1, xf1, yf1);
+
+        __m256 u = fadeAvx2(xf);
+        __m256 v = fadeAvx2(yf);
+        __m256 nxy = lerpAvx2(lerpAvx2(n00, n10, u), lerpAvx2(n01, n11, u), v);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(nxy, _mm256_set1_ps(1.41421356237f)));
+    }
+    return i;
+}
+
+#endif // CUBICA_NOISE_X86
+
+void perlin2dBatch(const float* xs, const float* ys, float* out, int n) {
+    int i = 0;
+#ifdef CUBICA_NOISE_X86
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    i = hasAvx2 ? perlinAvx2(xs, ys, out, n) : perlinSse2(xs, ys, out, n);
+#endif
+    for (; i < n; ++i) out[i] = perlin2d(xs[i], ys[i]);
+}
+
+void fbm2dBatch(const float* xs, const float* ys, float* out, int n, int octaves, float lacunarity, float gain) {
+    // one 16x16 chunk grid per block; each octave runs over the whole block
+    constexpr int BLOCK = 256;
+    float sx[BLOCK], sy[BLOCK], p[BLOCK];
+    for (int base = 0; base < n; base += BLOCK) {
+        int m = std::min(BLOCK, n - base);
+        float* sum = out + base;
+        std::fill(sum, sum + m, 0.0f);
+        // same accumulation order as fbm2d
+        float amp = 1.0f;
+        float freq = 1.0f;
+        float maxAmp = 0.0f;
+        for (int o = 0; o < octaves; ++o) {
+            for (int i = 0; i < m; ++i) {
+                sx[i] = xs[base + i] * freq;
+                sy[i] = ys[base + i] * freq;
+            }
+            perlin2dBatch(sx, sy, p, m);
+            for (int i = 0; i < m; ++i) sum[i] += p[i] * amp;
+            maxAmp += amp;
+            amp *= gain;
+            freq *= lacunarity;
+        }
+        for (int i = 0; i < m; ++i) sum[i] = (maxAmp == 0.0f) ? 0.0f : sum[i] / maxAmp;
+    }
+}
+
+} // namespace Noise
@@ -20,12 +20,19 @@ static inline uint32_t hash32(uint32_t x, uint32_t y) {
     return h;
 }
 
+// number of gradient directions; the low 16 hash bits pick one
+constexpr uint32_t GRADIENT_COUNT = 65536;
+
+// interleaved (cos, sin) pairs for every gradient angle, computed once with the
+// same std::cos/std::sin calls grad() used to make per sample
+const float* gradientTable();
+
 static inline float grad(int ix, int iy, float x, float y) {
     uint32_t h = hash32(static_cast<uint32_t>(ix), static_cast<uint32_t>(iy));
     // map hash to angle
-    float angle = (h & 0xFFFFu) * (2.0f * 3.14159265358979323846f / 65536.0f);
-    float gx = std::cos(angle);
-    float gy = std::sin(angle);
+    const float* g = gradientTable() + (h & (GRADIENT_COUNT - 1)) * 2;
+    float gx = g[0];
+    float gy = g[1];
     return gx * x + gy * y;
 }
 
@@ -66,4 +73,9 @@ static inline float fbm2d(float x, float y, int octaves = 4, float lacunarity =
     return sum / maxAmp; // normalized to roughly [-1,1]
 }
 
+// Batched versions over n sample points (xs[i], ys[i]). Results are bit-identical
+// to perlin2d / fbm2d per point; lanes run on AVX2 or SSE2 when available.
+void perlin2dBatch(const float* xs, const float* ys, float* out, int n);
+void fbm2dBatch(const float* xs, const float* ys, float* out, int n, int octaves = 4, float lacunarity = 2.0f, float gain = 0.5f);
+
 } // namespace Noise
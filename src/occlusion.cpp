@@ -0,0 +1,86 @@
+#include "occlusion.h"
+#include "mesh.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+// section faces as in Mesh: -X, +X, -Z, +Z, -Y, +Y
+constexpr int FACE_STEP[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, 0, -1}, {0, 0, 1}, {0, -1, 0}, {0, 1, 0}};
+int opposite(int face) { return face ^ 1; }
+} // namespace
+
+OcclusionCuller::Column* OcclusionCuller::columnAt(int cx, int cz) {
+    int gx = cx - minX, gz = cz - minZ;
+    if (gx < 0 || gz < 0 || gx >= sizeX || gz >= sizeZ) return nullptr;
+    Column& col = grid[static_cast<size_t>(gz) * sizeX + gx];
+    return col.loaded ? &col : nullptr;
+}
+
+uint8_t OcclusionCuller::visibleSections(int cx, int cz) const {
+    int gx = cx - minX, gz = cz - minZ;
+    if (gx < 0 || gz < 0 || gx >= sizeX || gz >= sizeZ) return 0;
+    return grid[static_cast<size_t>(gz) * sizeX + gx].reached;
+}
+
+void OcclusionCuller::update(const ChunkMap& chunks, const Math::Vec3& eye, const Math::Frustum& frustum) {
+    std::vector<ChunkPtr> loaded = chunks.snapshot();
+    int maxX = INT_MIN, maxZ = INT_MIN;
+    minX = INT_MAX;
+    minZ = INT_MAX;
+    for (const ChunkPtr& c : loaded) {
+        minX = std::min(minX, c->x); maxX = std::max(maxX, c->x);
+        minZ = std::min(minZ, c->z); maxZ = std::max(maxZ, c->z);
+    }
+    visited = 0;
+    if (loaded.empty()) {
+        sizeX = sizeZ = 0;
+        return;
+    }
+    sizeX = maxX - minX + 1;
+    sizeZ = maxZ - minZ + 1;
+    grid.assign(static_cast<size_t>(sizeX) * sizeZ, Column{});
+    for (const ChunkPtr& c : loaded) {
+        Column& col = grid[static_cast<size_t>(c->z - minZ) * sizeX + (c->x - minX)];
+        col.loaded = true;
+        if (c->mesh) col.connectivity = c->mesh->connectivity;
+        else col.connectivity.fill(ALL_FACES_CONNECTED);
+    }
+
+    int cx = static_cast<int>(std::floor(eye.x / CHUNK_SIZE));
+    int cz = static_cast<int>(std::floor(eye.z / CHUNK_SIZE));
+    int sy = static_cast<int>(std::floor(eye.y / SECTION_HEIGHT));
+    // above or below the world: start in the nearest section, entered from outside
+    int8_t entry = -1;
+    if (sy < 0) { sy = 0; entry = 4; }
+    if (sy >= SECTION_COUNT) { sy = SECTION_COUNT - 1; entry = 5; }
+    Column* start = columnAt(cx, cz);
+    if (!start) {
+        // nothing to walk from (e.g. the camera's chunk is still loading): hide nothing
+        for (Column& col : grid) col.reached = 0xFF;
+        return;
+    }
+
+    queue.clear();
+    start->reached |= 1u << sy;
+    queue.push_back({cx, sy, cz, entry, 0});
+    for (size_t head = 0; head < queue.size(); ++head) {
+        Step s = queue[head];
+        ++visited;
+        uint16_t links = columnAt(s.cx, s.cz)->connectivity[s.sy];
+        for (int face = 0; face < 6; ++face) {
+            // never turn back towards the camera
+            if (s.traveled & (1u << opposite(face))) continue;
+            if (s.entry >= 0 && (s.entry == face || !(links & (1u << facePairBit(s.entry, face))))) continue;
+            int nx = s.cx + FACE_STEP[face][0], ny = s.sy + FACE_STEP[face][1], nz = s.cz + FACE_STEP[face][2];
+            if (ny < 0 || ny >= SECTION_COUNT) continue;
+            Column* next = columnAt(nx, nz);
+            if (!next || (next->reached & (1u << ny))) continue;
+            Math::Vec3 lo{float(nx * CHUNK_SIZE), float(ny * SECTION_HEIGHT), float(nz * CHUNK_SIZE)};
+            Math::Vec3 hi{lo.x + CHUNK_SIZE, lo.y + SECTION_HEIGHT, lo.z + CHUNK_SIZE};
+            if (!frustum.intersectsBox(lo, hi)) continue;
+            next->reached |= 1u << ny;
+            queue.push_back({nx, ny, nz, static_cast<int8_t>(opposite(face)), static_cast<uint8_t>(s.traveled | (1u << face))});
+        }
+    }
+}
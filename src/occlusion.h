@@ -0,0 +1,43 @@
+#pragma once
+#include "chunk_map.h"
+#include "math.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Cave culling: a breadth-first walk over chunk sections from the camera's
+// section, stepping into a neighbour only through faces the current section
+// links (Mesh::connectivity) to the face it was entered by, never back towards
+// the camera, and only into sections inside the frustum. Whatever the walk
+// does not reach is hidden behind solid blocks. Chunks without a mesh yet are
+// treated as open; unloaded ones end the walk. If the camera's own chunk is not
+// loaded, nothing is hidden. Main thread, once per frame.
+class OcclusionCuller {
+public:
+    // walk from eye over the loaded chunks
+    void update(const ChunkMap& chunks, const Math::Vec3& eye, const Math::Frustum& frustum);
+    // sections of chunk cx, cz reached by the last update (bit per section)
+    uint8_t visibleSections(int cx, int cz) const;
+
+    uint32_t lastVisited() const { return visited; }
+
+private:
+    struct Column {
+        bool loaded = false;
+        uint8_t reached = 0;
+        std::array<uint16_t, SECTION_COUNT> connectivity{};
+    };
+    // dense grid over the loaded area, rebuilt every update
+    std::vector<Column> grid;
+    int minX = 0, minZ = 0, sizeX = 0, sizeZ = 0;
+    uint32_t visited = 0;
+
+    struct Step {
+        int cx, sy, cz;
+        int8_t entry;     // face of this section the walk came in by, -1 at the start
+        uint8_t traveled; // directions (face bits) taken so far
+    };
+    std::vector<Step> queue;
+
+    Column* columnAt(int cx, int cz);
+};
@@ -57,10 +57,9 @@ bool Player::raycast(World& world, float reach) {
         int bx0 = static_cast<int>(std::floor(rx));
         int by0 = static_cast<int>(std::floor(ry));
         int bz0 = static_cast<int>(std::floor(rz));
-        // ensure chunk exists
+        // chunks that are not streamed in yet are skipped, never generated here
         int cx = bx0 / CHUNK_SIZE; if (bx0<0 && bx0%CHUNK_SIZE) cx -= 1;
         int cz = bz0 / CHUNK_SIZE; if (bz0<0 && bz0%CHUNK_SIZE) cz -= 1;
-        world.generateChunk(cx, cz);
         auto c = world.getChunk(cx, cz);
         if (!c) continue;
         int lx = bx0 - cx * CHUNK_SIZE;
@@ -124,8 +123,13 @@ void Player::update(GLFWwindow* window, float dt, World& world, Inventory& inv)
 
     // gravity and jumping
     bool grounded = false;
-    float groundY = world.getHeightAt(x, z) + eyeHeight;
-    if (y <= groundY + 1e-4f) {
+    int groundH = world.getHeightAt(x, z);
+    float groundY = groundH + eyeHeight;
+    if (groundH == World::HEIGHT_UNKNOWN) {
+        // ground not streamed in yet: hold height instead of falling through
+        grounded = true;
+        yVel = 0.0f;
+    } else if (y <= groundY + 1e-4f) {
         grounded = true;
         y = groundY;
         yVel = 0.0f;
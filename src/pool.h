@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Thread-safe free-list pool for objects that are expensive to create or that
+// carry reusable resources (block storage capacity, GL names). acquire() hands
+// back a recycled object when one is available; release() never destroys, it
+// only parks the object, so it is safe from any thread. trim() is the only call
+// that destroys objects and should run where T's destructor is allowed to.
+template <typename T>
+class ObjectPool {
+public:
+    struct Stats {
+        uint64_t acquires = 0;
+        uint64_t hits = 0;      // acquires served from the free list
+        size_t live = 0;        // handed out and not yet released
+        size_t pooled = 0;      // parked on the free list
+        size_t footprint = 0;   // bytes of T objects owned (live + pooled)
+
+        double hitRate() const { return acquires ? double(hits) / double(acquires) : 0.0; }
+    };
+
+    explicit ObjectPool(size_t maxPooled = 256) : maxPooled(maxPooled) {}
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    ~ObjectPool() { for (T* obj : freeList) delete obj; }
+
+    T* acquire() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            ++stats_.acquires;
+            ++stats_.live;
+            if (!freeList.empty()) {
+                T* obj = freeList.back();
+                freeList.pop_back();
+                ++stats_.hits;
+                return obj;
+            }
+        }
+        return new T();
+    }
+
+    // park obj for reuse; the caller resets its contents before or after as T requires
+    void release(T* obj) {
+        if (!obj) return;
+        std::lock_guard<std::mutex> lk(mutex);
+        --stats_.live;
+        freeList.push_back(obj);
+    }
+
+    // destroy parked objects beyond maxPooled (or beyond keep if given)
+    void trim() { trim(maxPooled); }
+    void trim(size_t keep) {
+        std::vector<T*> victims;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            while (freeList.size() > keep) {
+                victims.push_back(freeList.back());
+                freeList.pop_back();
+            }
+        }
+        for (T* obj : victims) delete obj;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        Stats s = stats_;
+        s.pooled = freeList.size();
+        s.footprint = (s.live + s.pooled) * sizeof(T);
+        return s;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::vector<T*> freeList;
+    size_t maxPooled;
+    Stats stats_;
+};
@@ -0,0 +1,308 @@
+#include "region.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <shared_mutex>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(Block) == 1, "region records store one byte per palette entry");
+
+static constexpr uint32_t REGION_MAGIC = 0x47524243; // "CBRG"
+static constexpr uint32_t REGION_VERSION = 1;
+static constexpr size_t ENTRY_COUNT = REGION_SIZE * REGION_SIZE;
+static constexpr size_t HEADER_SIZE = 8 + ENTRY_COUNT * sizeof(uint64_t);
+
+static size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+static int floorDiv(int a, int b) { return static_cast<int>(std::floor(static_cast<float>(a) / b)); }
+
+static size_t entryIndex(int cx, int cz) {
+    int lx = cx - floorDiv(cx, REGION_SIZE) * REGION_SIZE;
+    int lz = cz - floorDiv(cz, REGION_SIZE) * REGION_SIZE;
+    return static_cast<size_t>(lz * REGION_SIZE + lx);
+}
+
+static uint64_t regionKey(int rx, int rz) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(rx)) << 32) | static_cast<uint32_t>(rz);
+}
+
+static bool makeDirs(const std::string& path) {
+    for (size_t pos = 1; pos <= path.size(); ++pos) {
+        if (pos != path.size() && path[pos] != '/') continue;
+        std::string part = path.substr(0, pos);
+        if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+struct RegionStore::Mapping {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+    }
+};
+
+// Superseded records are left in place until they outweigh the live ones and
+// this much; compaction then copies at most as much as was wasted since.
+static constexpr size_t COMPACT_SLACK = 1 << 20;
+
+static size_t recordOffset(uint64_t e) { return e >> 32; }
+static size_t recordLength(uint64_t e) { return e & 0xFFFFFFFFu; }
+
+// an entry must point at a whole, aligned record past the header
+static bool entryValid(uint64_t e, size_t fileSize) {
+    size_t offset = recordOffset(e), length = recordLength(e);
+    return offset >= HEADER_SIZE && offset % 8 == 0 && length >= 8 && offset + length <= fileSize;
+}
+
+// true if every packed index in words is below paletteSize
+static bool indicesInRange(const uint64_t* words, int bits, int paletteSize) {
+    if (paletteSize >= (1 << bits)) return true;
+    size_t count = BlockStorage::wordCountFor(SECTION_VOLUME, bits);
+    int perWord = 64 / bits;
+    uint64_t valueMask = (uint64_t(1) << bits) - 1;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t w;
+        std::memcpy(&w, &words[i], sizeof(w));
+        for (int j = 0; j < perWord; ++j, w >>= bits)
+            if ((w & valueMask) >= static_cast<uint64_t>(paletteSize)) return false;
+    }
+    return true;
+}
+
+RegionStore::RegionStore(std::string dir) : dir(std::move(dir)) {}
+
+RegionStore::~RegionStore() {
+    for (auto& [key, r] : regions)
+        if (r.fd >= 0) close(r.fd);
+}
+
+RegionStore::Region* RegionStore::openRegion(int rx, int rz, bool create) {
+    auto it = regions.find(regionKey(rx, rz));
+    if (it != regions.end()) {
+        it->second.lastUsed = ++useTick;
+        return &it->second;
+    }
+
+    std::string path = dir + "/r." + std::to_string(rx) + "." + std::to_string(rz) + ".cbr";
+    std::vector<uint64_t> entries(ENTRY_COUNT, 0);
+    size_t end = HEADER_SIZE;
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        if (!create) return nullptr;
+        if (!makeDirs(dir)) { std::cerr << "Region: cannot create " << dir << "\n"; return nullptr; }
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) { std::cerr << "Region: cannot create " << path << "\n"; return nullptr; }
+        std::vector<uint8_t> header(HEADER_SIZE, 0);
+        std::memcpy(header.data(), &REGION_MAGIC, 4);
+        std::memcpy(header.data() + 4, &REGION_VERSION, 4);
+        if (pwrite(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size())) {
+            close(fd);
+            return nullptr;
+        }
+    } else {
+        uint32_t magic = 0, version = 0;
+        struct stat st{};
+        size_t entryBytes = ENTRY_COUNT * sizeof(uint64_t);
+        if (pread(fd, &magic, 4, 0) != 4 || pread(fd, &version, 4, 4) != 4 ||
+            magic != REGION_MAGIC || version != REGION_VERSION || fstat(fd, &st) != 0 ||
+            pread(fd, entries.data(), entryBytes, 8) != static_cast<ssize_t>(entryBytes)) {
+            std::cerr << "Region: ignoring invalid file " << path << "\n";
+            close(fd);
+            return nullptr;
+        }
+        end = static_cast<size_t>(st.st_size);
+        // a broken entry reads as never saved; the next save of that chunk replaces it
+        for (uint64_t& e : entries)
+            if (e != 0 && !entryValid(e, end)) e = 0;
+    }
+    if (regions.size() >= MAX_OPEN_REGIONS) {
+        // its entries are all on disk; readers still holding its mapping keep it alive
+        auto idle = std::min_element(regions.begin(), regions.end(),
+                                     [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+        if (idle->second.fd >= 0) close(idle->second.fd);
+        regions.erase(idle);
+    }
+    Region& r = regions[regionKey(rx, rz)];
+    r.fd = fd;
+    r.lastUsed = ++useTick;
+    r.path = std::move(path);
+    r.entries = std::move(entries);
+    r.end = end;
+    for (uint64_t e : r.entries) r.live += recordLength(e);
+    return &r;
+}
+
+std::shared_ptr<RegionStore::Mapping> RegionStore::currentMapping(int rx, int rz, size_t slot, uint64_t& entry) {
+    std::lock_guard<std::mutex> lk(mutex);
+    Region* r = openRegion(rx, rz, false);
+    if (!r) return nullptr;
+    entry = r->entries[slot];
+    if (entry == 0) return nullptr;
+    size_t needed = recordOffset(entry) + recordLength(entry);
+    if (r->mapping && r->mapping->size >= needed) return r->mapping;
+
+    // the record was appended after the current mapping was taken
+    struct stat st{};
+    if (fstat(r->fd, &st) != 0 || static_cast<size_t>(st.st_size) < needed) return nullptr;
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, r->fd, 0);
+    if (p == MAP_FAILED) return nullptr;
+    auto m = std::make_shared<Mapping>();
+    m->data = static_cast<const uint8_t*>(p);
+    m->size = st.st_size;
+    // readers still decoding from the previous mapping keep it alive until they finish
+    r->mapping = m;
+    return m;
+}
+
+bool RegionStore::load(Chunk& c) {
+    int rx = floorDiv(c.x, REGION_SIZE), rz = floorDiv(c.z, REGION_SIZE);
+    uint64_t e = 0;
+    std::shared_ptr<Mapping> m = currentMapping(rx, rz, entryIndex(c.x, c.z), e);
+    if (!m) return false;
+
+    // entries were checked against the file, so the record is mapped and at least 8 bytes
+    const uint8_t* p = m->data + recordOffset(e);
+    const uint8_t* end = p + recordLength(e);
+    uint8_t mask = p[0];
+    p += 8;
+
+    std::array<SectionPtr, SECTION_COUNT> decoded;
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        if (!(mask & (1u << si))) continue;
+        if (end - p < 8) return false;
+        // the stored solid count is not trusted: it is recounted from the blocks
+        uint16_t paletteSize; uint8_t bits;
+        std::memcpy(&paletteSize, p, 2);
+        bits = p[2];
+        p += 8;
+        if (bits != 0 && bits != 1 && bits != 2 && bits != 4 && bits != 8) return false;
+        if (paletteSize == 0 || paletteSize > (1 << bits)) return false;
+        size_t wordBytes = BlockStorage::wordCountFor(SECTION_VOLUME, bits) * sizeof(uint64_t);
+        if (static_cast<size_t>(end - p) < align8(paletteSize) + wordBytes) return false;
+
+        const Block* palette = reinterpret_cast<const Block*>(p);
+        for (int i = 0; i < paletteSize; ++i)
+            if (p[i] > static_cast<uint8_t>(BlockType::LEAVES)) return false;
+        p += align8(paletteSize);
+        // record offsets are 8-aligned, so the index words can be read in place
+        const uint64_t* words = reinterpret_cast<const uint64_t*>(p);
+        if (!indicesInRange(words, bits, paletteSize)) return false;
+        p += wordBytes;
+
+        SectionPtr s = ChunkSection::acquire();
+        s->blocks.assign(palette, paletteSize, bits, words);
+        s->recount();
+        // sections are only allocated while they hold a block
+        if (s->solidCount) decoded[si] = std::move(s);
+    }
+
+    std::unique_lock<std::shared_mutex> lk(c.blockMutex);
+    for (int si = 0; si < SECTION_COUNT; ++si) {
+        c.sections[si] = std::move(decoded[si]);
+        c.sectionFill[si] = c.sections[si] ? c.sections[si]->fill() : SectionFill::AIR;
+    }
+    c.recomputeHeightmapUnlocked();
+    return true;
+}
+
+bool RegionStore::save(const Chunk& c) {
+    std::vector<uint8_t> rec(8, 0);
+    {
+        std::shared_lock<std::shared_mutex> lk(c.blockMutex);
+        for (int si = 0; si < SECTION_COUNT; ++si) {
+            const ChunkSection* s = c.sections[si].get();
+            if (!s) continue;
+            rec[0] |= static_cast<uint8_t>(1u << si);
+            const auto& palette = s->blocks.getPalette();
+            const auto& words = s->blocks.getWords();
+            uint16_t paletteSize = static_cast<uint16_t>(palette.size());
+            uint8_t bits = static_cast<uint8_t>(s->blocks.bitsPerEntry());
+            uint32_t solidCount = static_cast<uint32_t>(s->solidCount);
+
+            size_t at = rec.size();
+            rec.resize(at + 8 + align8(paletteSize) + words.size() * sizeof(uint64_t), 0);
+            std::memcpy(&rec[at], &paletteSize, 2);
+            rec[at + 2] = bits;
+            std::memcpy(&rec[at + 4], &solidCount, 4);
+            std::memcpy(&rec[at + 8], palette.data(), paletteSize);
+            if (!words.empty())
+                std::memcpy(&rec[at + 8 + align8(paletteSize)], words.data(), words.size() * sizeof(uint64_t));
+        }
+    }
+
+    int rx = floorDiv(c.x, REGION_SIZE), rz = floorDiv(c.z, REGION_SIZE);
+    std::lock_guard<std::mutex> lk(mutex);
+    Region* r = openRegion(rx, rz, true);
+    if (!r) return false;
+
+    size_t offset = align8(r->end);
+    if (offset + rec.size() > 0xFFFFFFFFu) { std::cerr << "Region: file full\n"; return false; }
+    if (pwrite(r->fd, rec.data(), rec.size(), offset) != static_cast<ssize_t>(rec.size())) return false;
+    r->end = offset + rec.size();
+
+    // publish the record only after its bytes are in the file
+    size_t slot = entryIndex(c.x, c.z);
+    uint64_t e = (static_cast<uint64_t>(offset) << 32) | rec.size();
+    off_t entryAt = 8 + static_cast<off_t>(slot * sizeof(uint64_t));
+    if (pwrite(r->fd, &e, sizeof(e), entryAt) != sizeof(e)) return false;
+    r->live += rec.size() - recordLength(r->entries[slot]);
+    r->entries[slot] = e;
+
+    size_t used = HEADER_SIZE + r->live;
+    size_t wasted = r->end > used ? r->end - used : 0;
+    if (wasted > r->live + COMPACT_SLACK && !compact(*r))
+        std::cerr << "Region: cannot compact " << r->path << "\n";
+    return true;
+}
+
+bool RegionStore::compact(Region& r) {
+    std::string tmpPath = r.path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    std::vector<uint64_t> entries(ENTRY_COUNT, 0);
+    std::vector<uint8_t> rec;
+    size_t end = HEADER_SIZE;
+    bool ok = true;
+    for (size_t i = 0; i < ENTRY_COUNT && ok; ++i) {
+        uint64_t e = r.entries[i];
+        if (e == 0) continue;
+        size_t length = recordLength(e);
+        rec.resize(length);
+        size_t offset = align8(end);
+        ok = pread(r.fd, rec.data(), length, recordOffset(e)) == static_cast<ssize_t>(length) &&
+             pwrite(fd, rec.data(), length, offset) == static_cast<ssize_t>(length);
+        entries[i] = (static_cast<uint64_t>(offset) << 32) | length;
+        end = offset + length;
+    }
+    std::vector<uint8_t> header(HEADER_SIZE);
+    std::memcpy(header.data(), &REGION_MAGIC, 4);
+    std::memcpy(header.data() + 4, &REGION_VERSION, 4);
+    std::memcpy(header.data() + 8, entries.data(), ENTRY_COUNT * sizeof(uint64_t));
+    // the copy is on disk before it replaces the only other one
+    ok = ok && pwrite(fd, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size()) &&
+         fsync(fd) == 0 && rename(tmpPath.c_str(), r.path.c_str()) == 0;
+    if (!ok) {
+        close(fd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    // mappings of the old file stay valid; the next load maps the new one
+    close(r.fd);
+    r.fd = fd;
+    r.entries = std::move(entries);
+    r.end = end;
+    r.mapping.reset();
+    return true;
+}
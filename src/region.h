@@ -0,0 +1,63 @@
+#pragma once
+#include "chunk.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+constexpr int REGION_SIZE = 32; // chunks per region side
+
+// Region files group REGION_SIZE x REGION_SIZE chunks:
+//   header  magic, version, then one packed {offset, length} entry per chunk
+//   body    chunk records appended at 8-byte aligned offsets
+// A record is a section mask followed by each present section's palette and
+// packed index words, i.e. BlockStorage's own layout in native byte order.
+// Loads mmap the file and decode sections straight out of the mapped pages.
+// Records are only ever appended, so the record bytes a reader's mapping covers
+// never change under it; a re-save points the chunk's entry at the new record.
+// The header does change, so entries are read from a copy kept under the mutex
+// rather than from the mapping. Once the superseded records outweigh the live
+// ones the file is rewritten with only the live records and renamed over the
+// old one; mappings of the old file stay valid until their readers let go.
+// Records are checked before use: a corrupt one loads as never saved.
+class RegionStore {
+public:
+    explicit RegionStore(std::string dir);
+    ~RegionStore();
+    RegionStore(const RegionStore&) = delete;
+    RegionStore& operator=(const RegionStore&) = delete;
+
+    // decode the stored chunk at c.x,c.z into c; false if it was never saved
+    bool load(Chunk& c);
+    // append the chunk's current blocks to its region file
+    bool save(const Chunk& c);
+
+private:
+    struct Mapping;
+    struct Region {
+        int fd = -1;
+        std::string path;
+        std::vector<uint64_t> entries; // the header's {offset, length} entries
+        size_t end = 0;                // file size
+        size_t live = 0;               // bytes of the records entries point at
+        std::shared_ptr<Mapping> mapping; // null until first load or after a compaction
+        uint64_t lastUsed = 0;
+    };
+
+    // regions kept open; the least recently used one is closed to open another
+    static constexpr size_t MAX_OPEN_REGIONS = 16;
+
+    std::string dir;
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Region> regions;
+    uint64_t useTick = 0;
+
+    // the open region, opened (and an idle one closed) if need be; mutex held
+    Region* openRegion(int rx, int rz, bool create);
+    // the slot's entry and a mapping that covers its record; null if never saved
+    std::shared_ptr<Mapping> currentMapping(int rx, int rz, size_t slot, uint64_t& entry);
+    // rewrite the file with only the records the entries point at
+    bool compact(Region& r);
+};
@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <vector>
 #include <string>
+#include <algorithm>
 
 static std::string getExeDir() {
     char buf[1024];
@@ -60,13 +61,25 @@ static GLuint compile(GLenum type, const char* src) {
     return s;
 }
 
-bool Shader::loadFromFiles(const char* vertPath, const char* fragPath) {
+static void insertDefines(std::string& src, const char* defines) {
+    if (!defines || src.empty()) return;
+    size_t pos = 0;
+    if (src.compare(0, 8, "#version") == 0) {
+        pos = src.find('\n');
+        pos = pos == std::string::npos ? src.size() : pos + 1;
+    }
+    src.insert(pos, defines);
+}
+
+bool Shader::loadFromFiles(const char* vertPath, const char* fragPath, const char* defines) {
     std::string vs = readFile(vertPath);
     std::string fs = readFile(fragPath);
     if (vs.empty() || fs.empty()) {
         std::cerr << "One or more shader sources are empty (" << vertPath << ", " << fragPath << ")\n";
         return false;
     }
+    insertDefines(vs, defines);
+    insertDefines(fs, defines);
     GLuint v = compile(GL_VERTEX_SHADER, vs.c_str());
     GLuint f = compile(GL_FRAGMENT_SHADER, fs.c_str());
     id = glCreateProgram();
@@ -75,12 +88,60 @@ bool Shader::loadFromFiles(const char* vertPath, const char* fragPath) {
     GLint ok=0; glGetProgramiv(id, GL_LINK_STATUS, &ok);
     if(!ok){ char buf[1024]; glGetProgramInfoLog(id, 1024, nullptr, buf); std::cerr<<buf<<"\n"; glDeleteShader(v); glDeleteShader(f); glDeleteProgram(id); id = 0; return false; }
     glDeleteShader(v); glDeleteShader(f);
+    reflect();
     return true;
 }
 
+void Shader::reflect() {
+    locations.clear();
+    if (!id) return;
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buf(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0; GLint size = 0; GLenum type = 0;
+        glGetActiveUniform(id, static_cast<GLuint>(i), maxLength, &length, &size, &type, buf.data());
+        std::string name(buf.data(), length);
+        // block members have no location; arrays report "name[0]"
+        GLint loc = glGetUniformLocation(id, name.c_str());
+        if (loc < 0) continue;
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) name.resize(name.size() - 3);
+        locations.emplace(std::move(name), loc);
+    }
+}
+
+GLint Shader::location(const char* name) const {
+    auto it = locations.find(name);
+    return it == locations.end() ? -1 : it->second;
+}
+
+void Shader::bindBlock(const char* name, GLuint binding) const {
+    if (!id) return;
+    GLuint index = glGetUniformBlockIndex(id, name);
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(id, index, binding);
+}
+
 Shader::~Shader() {
     if (id) {
         glDeleteProgram(id);
         id = 0;
     }
 }
+
+UniformBuffer::~UniformBuffer() {
+    if (buffer) glDeleteBuffers(1, &buffer);
+}
+
+void UniformBuffer::update(GLuint binding, const void* data, size_t size) {
+    if (!buffer) glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if (size > capacity) {
+        glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+        capacity = size;
+    } else {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
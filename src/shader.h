@@ -1,7 +1,16 @@
 #pragma once
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <glad/glad.h>
+#include "math.h"
+
+// Typed handle to a uniform location, looked up once and kept by the caller;
+// -1 (not in the program) makes the set a no-op, as GL itself does.
+template <typename T>
+struct Uniform {
+    GLint location = -1;
+};
 
 class Shader {
 public:
@@ -10,9 +19,57 @@ public:
     ~Shader();
     Shader(const Shader&) = delete;
     Shader& operator=(const Shader&) = delete;
-    bool loadFromFiles(const char* vertPath, const char* fragPath);
+    // defines (e.g. "#define CUTOUT\n") are inserted after each stage's #version line
+    bool loadFromFiles(const char* vertPath, const char* fragPath, const char* defines = nullptr);
+    // rebuild the location table from the linked program; loadFromFiles does
+    // this itself, programs linked elsewhere into id call it after linking
+    void reflect();
     void use() const { if (id) glUseProgram(id); }
-    void setMat4(const char* name, const float* data) const { if (id) glUniformMatrix4fv(glGetUniformLocation(id, name), 1, GL_FALSE, data); }
-    void setInt(const char* name, int value) const { if (id) glUniform1i(glGetUniformLocation(id, name), value); }
-    void setFloat(const char* name, float value) const { if (id) glUniform1f(glGetUniformLocation(id, name), value); }
+
+    GLint location(const char* name) const;
+    template <typename T>
+    Uniform<T> uniform(const char* name) const { return {location(name)}; }
+    // the program must be in use
+    void set(Uniform<int> u, int value) const { glUniform1i(u.location, value); }
+    void set(Uniform<float> u, float value) const { glUniform1f(u.location, value); }
+    void set(Uniform<Math::Mat4> u, const Math::Mat4& m) const { glUniformMatrix4fv(u.location, 1, GL_FALSE, m.data()); }
+    void set(Uniform<Math::Vec4> u, const Math::Vec4& v) const { glUniform4f(u.location, v.x, v.y, v.z, v.w); }
+
+    void setMat4(const char* name, const float* data) const { if (id) glUniformMatrix4fv(location(name), 1, GL_FALSE, data); }
+    void setInt(const char* name, int value) const { if (id) glUniform1i(location(name), value); }
+    void setFloat(const char* name, float value) const { if (id) glUniform1f(location(name), value); }
+    void setVec4Array(const char* name, const float* data, int count) const { if (id) glUniform4fv(location(name), count, data); }
+
+    // attach the named uniform block to a buffer binding point
+    void bindBlock(const char* name, GLuint binding) const;
+
+private:
+    // active uniforms by name; arrays are stored under their bare name
+    std::unordered_map<std::string, GLint> locations;
+};
+
+// std140 block "Frame" in voxel.vert / voxel.frag: per-frame camera data,
+// written once and read by every program that binds the block
+struct FrameUniforms {
+    Math::Mat4 projection;
+    Math::Mat4 view;
+    float snowLine = 80.0f;
+    float snowBlendRange = 8.0f;
+    float pad[2] = {};
+};
+static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms must match the std140 layout of Frame");
+
+class UniformBuffer {
+public:
+    static constexpr GLuint FRAME_BINDING = 0;
+    UniformBuffer() = default;
+    ~UniformBuffer();
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+    // replace the contents and (re)attach the buffer to binding
+    void update(GLuint binding, const void* data, size_t size);
+
+private:
+    GLuint buffer = 0;
+    size_t capacity = 0;
 };
@@ -42,6 +42,8 @@ bool UIRenderer::init(){
     GLuint v=compileSrc(GL_VERTEX_SHADER, uiVertSrc); GLuint f=compileSrc(GL_FRAGMENT_SHADER, uiFragSrc);
     glAttachShader(shader.id,v); glAttachShader(shader.id,f); glLinkProgram(shader.id);
     glDeleteShader(v); glDeleteShader(f);
+    shader.reflect();
+    tint = shader.uniform<Math::Vec4>("tint");
     glGenVertexArrays(1,&vao); glGenBuffers(1,&vbo);
     glBindVertexArray(vao); glBindBuffer(GL_ARRAY_BUFFER,vbo);
     glEnableVertexAttribArray(0); glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,4*sizeof(float),(void*)0);
@@ -51,7 +53,7 @@ bool UIRenderer::init(){
     loadBuiltInFont();
     // set default tint to white so drawSprite doesn't need to override it
     shader.use();
-    glUniform4f(glGetUniformLocation(shader.id, "tint"), 1.0f,1.0f,1.0f,1.0f);
+    shader.set(tint, {1.0f,1.0f,1.0f,1.0f});
     return true;
 }
 
@@ -97,11 +99,11 @@ void UIRenderer::drawRect(float x,float y,float w,float h, float r,float g,float
     shader.use();
     // bind white texture
     glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, whiteTex);
-    glUniform4f(glGetUniformLocation(shader.id, "tint"), r,g,b,a);
+    shader.set(tint, {r,g,b,a});
     drawSprite(x,y,w,h,0,1,windowW,windowH);
     // reset tint
     shader.use();
-    glUniform4f(glGetUniformLocation(shader.id, "tint"), 1.0f,1.0f,1.0f,1.0f);
+    shader.set(tint, {1.0f,1.0f,1.0f,1.0f});
 }
 
 bool UIRenderer::loadBuiltInFont(){
@@ -143,7 +145,7 @@ void UIRenderer::drawText(float x,float y,int size,const std::string& text, floa
         shader.use();
         font->bind(0);
         glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glUniform4f(glGetUniformLocation(shader.id, "tint"), r,g,b,a);
+        shader.set(tint, {r,g,b,a});
         float penX = (float)x;
         float penY = (float)y;
         // Simple bitmap rendering using glyph sizes; precise UV mapping not implemented yet
@@ -162,7 +164,7 @@ void UIRenderer::drawText(float x,float y,int size,const std::string& text, floa
         glDisable(GL_BLEND);
         // reset tint
         shader.use();
-        glUniform4f(glGetUniformLocation(shader.id, "tint"), 1.0f,1.0f,1.0f,1.0f);
+        shader.set(tint, {1.0f,1.0f,1.0f,1.0f});
         return;
     }
 
@@ -192,17 +194,17 @@ void UIRenderer::drawBlock3D(float x,float y,float w,float h,int tileTop,int til
     // simple 3-quad illusion: left side, front, then top
     // left side (darker)
     shader.use();
-    glUniform4f(glGetUniformLocation(shader.id, "tint"), 0.75f,0.75f,0.75f,1.0f);
+    shader.set(tint, {0.75f,0.75f,0.75f,1.0f});
     drawSprite(x, y + h*0.25f, w*0.5f, h*0.65f, tileSide, atlasTiles, windowW, windowH);
     // front face (mid-tone)
-    glUniform4f(glGetUniformLocation(shader.id, "tint"), 0.9f,0.9f,0.9f,1.0f);
+    shader.set(tint, {0.9f,0.9f,0.9f,1.0f});
     drawSprite(x + w*0.45f, y + h*0.25f, w*0.5f, h*0.65f, tileFront, atlasTiles, windowW, windowH);
     // top face (bright)
-    glUniform4f(glGetUniformLocation(shader.id, "tint"), 1.0f,1.0f,1.0f,1.0f);
+    shader.set(tint, {1.0f,1.0f,1.0f,1.0f});
     drawSprite(x + w*0.15f, y, w*0.7f, h*0.35f, tileTop, atlasTiles, windowW, windowH);
     // reset tint
     shader.use();
-    glUniform4f(glGetUniformLocation(shader.id, "tint"), 1.0f,1.0f,1.0f,1.0f);
+    shader.set(tint, {1.0f,1.0f,1.0f,1.0f});
 }
 
 void UIRenderer::drawSpriteUV(float x,float y,float w,float h,float u0,float v0,float u1,float v1, int windowW, int windowH){
@@ -269,7 +271,7 @@ void UIRenderer::drawLogo(float x,float y,float w,float h, int windowW, int wind
 
     glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, logoTex);
     // ensure shader tint is neutral
-    shader.use(); glUniform4f(glGetUniformLocation(shader.id, "tint"), 1.0f,1.0f,1.0f,1.0f);
+    shader.use(); shader.set(tint, {1.0f,1.0f,1.0f,1.0f});
     drawSprite(ox, oy, targetW, targetH, 0, 1, windowW, windowH);
     // unbind logo texture to avoid interfering with atlas usage
     glBindTexture(GL_TEXTURE_2D, 0);
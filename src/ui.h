@@ -8,6 +8,7 @@
 class UIRenderer {
 public:
     Shader shader;
+    Uniform<Math::Vec4> tint;
     GLuint vao=0,vbo=0;
     UIRenderer();
     ~UIRenderer();
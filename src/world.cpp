@@ -1,44 +1,117 @@
 #include "world.h"
+#include "mesh.h"
 #include <memory>
 #include <cmath>
 #include <algorithm>
-#include <thread>
-#include <mutex>
-#include <iostream>
+#include <chrono>
 #include <vector>
 
 World::World() {}
 
 World::~World() {
-    for (auto& [key, chunk] : chunks)
-        delete chunk;
+    // workers reference this World; stop them before anything else goes away
+    jobs.shutdown();
+    chunks.clear();
 }
 
-Chunk* World::getChunk(int cx, int cz) {
-    std::lock_guard<std::mutex> lk(chunksMutex);
-    auto it = chunks.find({cx, cz});
-    if (it != chunks.end()) return it->second;
-    return nullptr;
+ChunkPtr World::getChunk(int cx, int cz) const {
+    ChunkPtr c = chunks.find(cx, cz);
+    if (c) touch(*c);
+    return c;
+}
+
+ChunkPtr World::loadOrGenerate(int cx, int cz) {
+    auto c = std::make_shared<Chunk>(cx, cz);
+    // a stored chunk decodes far faster than it regenerates
+    if (regions.load(*c)) c->needsMesh = true;
+    else c->generate(); // safe to do off-main thread
+    // light is not stored; relit from the chunk's own blocks, joined with its neighbours once published
+    LightEngine::lightChunk(*c);
+    return c;
 }
 
 void World::generateChunk(int cx, int cz) {
-    // quick double-check: avoid holding lock for generation
-    {
-        std::lock_guard<std::mutex> lk(chunksMutex);
-        auto it = chunks.find({cx, cz});
-        if (it != chunks.end()) return; // already exists
-        // reserve spot
-        chunks[{cx, cz}] = nullptr;
+    // reserve the slot so no other thread generates the same chunk; generation runs unlocked
+    if (!chunks.reserve(cx, cz)) {
+        // still queued on the pool: take the job over instead of waiting for it
+        if (!jobs.cancel(cx, cz, JobPool::GENERATE)) return; // already exists or in progress
     }
+    publishChunk(cx, cz, loadOrGenerate(cx, cz));
+}
 
-    Chunk* c = new Chunk(cx, cz);
-    c->generate(); // safe to do off-main thread
+void World::requestChunk(int cx, int cz) {
+    if (!chunks.reserve(cx, cz)) return; // loaded, queued or being generated
+    bool queued = jobs.submit(cx, cz, JobPool::GENERATE, [this, cx, cz]() {
+        publishChunk(cx, cz, loadOrGenerate(cx, cz));
+    });
+    if (!queued) chunks.erase(cx, cz);
+}
 
-    {
-        std::lock_guard<std::mutex> lk(chunksMutex);
-        chunks[{cx, cz}] = c;
+void World::publishChunk(int cx, int cz, ChunkPtr c) {
+    chunks.publish(cx, cz, std::move(c));
+    remeshNeighbors(cx, cz);
+    light.queueBorders(cx, cz);
+    scheduleLight(cx, cz);
+}
+
+void World::remeshNeighbors(int cx, int cz) {
+    const int offs[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    for (const auto& o : offs) {
+        if (ChunkPtr n = chunks.find(cx + o[0], cz + o[1])) {
+            n->dirtySections = 0xFF; // the whole shared border may have changed
+            n->needsMesh = true;
+        }
     }
-    // mesh rebuild should occur on main thread
+}
+
+int World::lodFor(const Chunk& c) const {
+    if (streamCenterX == 0x7fffffff) return 0; // no player position yet
+    int d = std::max(std::abs(c.x - streamCenterX), std::abs(c.z - streamCenterZ));
+    int current = c.lod.load();
+    int lod = 0;
+    for (int i = 0; i < Mesh::MAX_LOD; ++i) {
+        // hysteresis: levels coarser than the current one need one chunk more
+        int radius = lodRadius[i] + (i + 1 > current ? 1 : 0);
+        if (d > radius) lod = i + 1;
+    }
+    return lod;
+}
+
+void World::updateLod() {
+    std::vector<std::pair<int, int>> changed;
+    chunks.forEach([&](const ChunkPtr& c) {
+        int lod = lodFor(*c);
+        if (lod == c->lod.load()) return;
+        c->lod = static_cast<uint8_t>(lod);
+        c->needsMesh = true; // the mesh job rebuilds every section at the new level
+        changed.emplace_back(c->x, c->z);
+    });
+    // the borders between them and their neighbours are sealed differently now
+    for (const auto& [cx, cz] : changed) remeshNeighbors(cx, cz);
+}
+
+void World::setMeshMode(MeshMode mode) {
+    if (mode == meshMode) return;
+    // stored before the dirty masks: a job that takes a full mask also sees the new mode
+    meshMode = mode;
+    chunks.forEach([](const ChunkPtr& c) {
+        c->dirtySections = 0xFF;
+        c->needsMesh = true;
+    });
+}
+
+void World::scheduleLight(int cx, int cz) {
+    if (lightScheduled.exchange(true)) return;
+    // the job drains everything queued by then; later updates schedule another
+    bool queued = jobs.submit(cx, cz, JobPool::LIGHT, [this]() {
+        lightScheduled = false;
+        light.process();
+    });
+    if (!queued) lightScheduled = false;
+}
+
+void World::setViewer(float px, float pz, float dirX, float dirZ) {
+    jobs.setFocus(px, pz, dirX, dirZ);
 }
 
 int World::getHeightAt(float wx, float wz) {
@@ -48,20 +121,19 @@ int World::getHeightAt(float wx, float wz) {
     int lx = static_cast<int>(std::floor(wx)) - cx * CHUNK_SIZE;
     int lz = static_cast<int>(std::floor(wz)) - cz * CHUNK_SIZE;
 
-    // generate chunk if missing
-    generateChunk(cx, cz);
-    Chunk* c = getChunk(cx, cz);
-    if (!c) return 0;
+    // one map lookup plus a heightmap read; never generate here (this runs on the render
+    // thread) — queue the chunk and report unknown instead
+    ChunkPtr c = getChunk(cx, cz);
+    if (!c) {
+        requestChunk(cx, cz);
+        return HEIGHT_UNKNOWN;
+    }
 
     // clamp local indices
     lx = std::clamp(lx, 0, CHUNK_SIZE - 1);
     lz = std::clamp(lz, 0, CHUNK_SIZE - 1);
 
-    for (int y = CHUNK_HEIGHT - 1; y >= 0; --y) {
-        auto b = c->getBlock(lx, y, lz);
-        if (b.type != BlockType::AIR) return y;
-    }
-    return -1;
+    return c->surfaceHeight(lx, lz);
 }
 
 Block World::getBlockAt(int wx, int wy, int wz) const {
@@ -69,10 +141,9 @@ Block World::getBlockAt(int wx, int wy, int wz) const {
     int cz = static_cast<int>(std::floor((float)wz / CHUNK_SIZE));
     int lx = wx - cx * CHUNK_SIZE;
     int lz = wz - cz * CHUNK_SIZE;
-    // need to const_cast to call generateChunk/getChunk? we won't generate here — assume chunk exists
-    auto it = chunks.find({cx, cz});
-    if (it == chunks.end() || !it->second) return Block{BlockType::AIR};
-    Chunk* c = it->second;
+    // we won't generate here — missing chunks read as air
+    ChunkPtr c = chunks.find(cx, cz);
+    if (!c) return Block{BlockType::AIR};
     if (lx < 0 || lx >= CHUNK_SIZE || lz < 0 || lz >= CHUNK_SIZE || wy < 0 || wy >= CHUNK_HEIGHT) return Block{BlockType::AIR};
     return c->getBlock(lx, wy, lz);
 }
@@ -82,59 +153,263 @@ void World::setBlockAt(int wx, int wy, int wz, Block block) {
     int cz = static_cast<int>(std::floor((float)wz / CHUNK_SIZE));
     int lx = wx - cx * CHUNK_SIZE;
     int lz = wz - cz * CHUNK_SIZE;
-    generateChunk(cx, cz);
-    Chunk* c = getChunk(cx, cz);
+    // local edits always target a loaded chunk; only network threads can reach an
+    // unloaded one, and they may generate it synchronously
+    ChunkPtr c = getChunk(cx, cz);
+    if (!c) {
+        generateChunk(cx, cz);
+        c = getChunk(cx, cz);
+    }
     if (!c) return;
     if (lx < 0 || lx >= CHUNK_SIZE || lz < 0 || lz >= CHUNK_SIZE || wy < 0 || wy >= CHUNK_HEIGHT) return;
     c->setBlock(lx, wy, lz, block);
-    c->needsMesh = true; // schedule mesh rebuild
+    c->modified = true;
+    // a border block can hide or expose a face of the chunk next to it, in the same
+    // section; a coarse neighbour's skirts follow blocks up to its largest cube in
+    uint16_t remesh = 1u << 4;
+    auto dirtyNeighbor = [&](int dx, int dz, int depth) {
+        ChunkPtr n = chunks.find(cx + dx, cz + dz);
+        if (!n) return;
+        if (n->lod.load() != 0 && depth < (1 << Mesh::MAX_LOD)) n->dirtySections = 0xFF;
+        else if (depth == 0) n->markSectionDirty(wy);
+        else return;
+        remesh |= static_cast<uint16_t>(1u << ((dz + 1) * 3 + dx + 1));
+    };
+    dirtyNeighbor(-1, 0, lx);
+    dirtyNeighbor(1, 0, CHUNK_SIZE - 1 - lx);
+    dirtyNeighbor(0, -1, lz);
+    dirtyNeighbor(0, 1, CHUNK_SIZE - 1 - lz);
+    // the relight runs on the pool and flags these chunks for meshing when done,
+    // so no build reads the changed cell's old light and the sections whose
+    // light changed join the edit's in one rebuild
+    light.queueBlock(wx, wy, wz, remesh);
+    scheduleLight(cx, cz);
 }
 
-
-void World::pregenerateAsync(int radius) {
-    // spawn a detached thread to generate blocks in a square radius
-    std::thread([this, radius]() {
-        std::cout << "Pregeneration: generating radius=" << radius << "\n";
-        for (int cx = -radius; cx <= radius; ++cx) {
-            for (int cz = -radius; cz <= radius; ++cz) {
-                this->generateChunk(cx, cz);
+void World::submitMesh(const ChunkPtr& c) {
+    std::weak_ptr<Chunk> weak = c;
+    const ResourcePack* rp = resourcePack;
+    uint64_t serial = c->meshSerial + 1;
+    // an already queued job for this chunk will read the newest blocks when it runs
+    if (!jobs.submit(c->x, c->z, JobPool::MESH, [this, weak, rp, serial]() {
+        ChunkPtr chunk = weak.lock();
+        if (!chunk) return; // unloaded while queued
+        MeshResult r;
+        r.chunk = weak;
+        r.serial = serial;
+        int lod = chunk->lod.load();
+        // neighbours are looked up when the job runs, so it sees the latest ones;
+        // full-detail chunks only cull against each other and keep a closed
+        // border towards coarser ones, which size their skirts by any neighbour
+        ChunkPtr nb[4];
+        nb[0] = chunks.find(chunk->x - 1, chunk->z);
+        nb[1] = chunks.find(chunk->x + 1, chunk->z);
+        nb[2] = chunks.find(chunk->x, chunk->z - 1);
+        nb[3] = chunks.find(chunk->x, chunk->z + 1);
+        if (lod == 0)
+            for (ChunkPtr& n : nb)
+                if (n && n->lod.load() != 0) n = nullptr;
+        Mesh::Neighbors neighbors = {nb[0].get(), nb[1].get(), nb[2].get(), nb[3].get()};
+        {
+            // rebuild only the dirty sections into the chunk's cache, then hand over all of them
+            // (shared, not copied); the GL thread uploads the ones whose version it hasn't seen yet
+            SectionMeshCache& cache = *chunk->meshCache;
+            std::lock_guard<std::mutex> ck(cache.mutex);
+            // read before meshing: an edit racing the build makes the result look stale, never fresh
+            r.revision = chunk->blockRevision.load();
+            uint8_t dirty = chunk->dirtySections.exchange(0);
+            MeshMode mode = meshMode;
+            if (cache.lod != lod) {
+                dirty = 0xFF;
+                cache.lod = lod;
             }
+            thread_local SectionVertices built;
+            Mesh::buildSections(chunk.get(), neighbors, rp, mode, dirty, built, &cache.connectivity, lod, &cache.cutoutQuads);
+            for (int si = 0; si < SECTION_COUNT; ++si) {
+                if (!(dirty & (1u << si))) continue;
+                // a list a pending result still holds is left to it; otherwise its storage is reused
+                auto& list = cache.sections[si];
+                if (!list || list.use_count() > 1) list = std::make_shared<std::vector<PackedVertex>>();
+                list->swap(built[si]);
+                cache.versions[si] = cache.nextVersion++;
+            }
+            for (int si = 0; si < SECTION_COUNT; ++si) r.sections[si] = cache.sections[si];
+            r.versions = cache.versions;
+            r.cutoutQuads = cache.cutoutQuads;
+            r.connectivity = cache.connectivity;
         }
-        std::cout << "Pregeneration: done\n";
-    }).detach();
+        std::lock_guard<std::mutex> lk(meshResultMutex);
+        meshResults.push_back(std::move(r));
+    })) return;
+    c->meshSerial = serial;
 }
 
-void World::processMeshQueue(int maxRebuild) {
-    int rebuilt = 0;
-    // find chunks needing mesh rebuild
-    std::vector<Chunk*> toRebuild;
+void World::processMeshQueue(double budgetMs) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    // hand chunks needing a mesh to the pool (nearest and in-view first, like generation)
+    chunks.forEach([&](const ChunkPtr& c) {
+        if (!c->needsMesh.exchange(false)) return;
+        // a chunk's first mesh is built at its level right away
+        if (c->meshSerial == 0) c->lod = static_cast<uint8_t>(lodFor(*c));
+        submitMesh(c);
+    });
+
+    std::vector<MeshResult> ready;
     {
-        std::lock_guard<std::mutex> lk(chunksMutex);
-        for (auto &p : chunks) {
-            Chunk* c = p.second;
-            if (c && c->needsMesh) toRebuild.push_back(c);
-            if ((int)toRebuild.size() >= maxRebuild) break;
+        std::lock_guard<std::mutex> lk(meshResultMutex);
+        ready.swap(meshResults);
+    }
+    size_t i = 0;
+    for (; i < ready.size(); ++i) {
+        if (i > 0 && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() > budgetMs) break;
+        MeshResult& r = ready[i];
+        ChunkPtr c = r.chunk.lock();
+        // evicted chunks and meshes of superseded blocks are dropped; an edit
+        // bumps the revision and sets needsMesh, so a newer build is on its way
+        if (!c || chunks.find(c->x, c->z) != c) continue;
+        if (r.revision != c->blockRevision.load()) continue;
+        // two builds can run at once (e.g. after a neighbour arrived); keep the newest
+        if (r.serial < c->uploadedMeshSerial) continue;
+        c->uploadMesh(r.sections, r.versions, r.cutoutQuads, r.connectivity);
+        c->uploadedMeshSerial = r.serial;
+    }
+    if (i < ready.size()) {
+        // over budget: the rest waits for the next frame, ahead of newer results
+        std::lock_guard<std::mutex> lk(meshResultMutex);
+        meshResults.insert(meshResults.begin(), std::make_move_iterator(ready.begin() + i), std::make_move_iterator(ready.end()));
+    }
+
+    // meshes of chunks destroyed elsewhere are only cleared and pooled here, on the
+    // GL thread; sections an eviction wave parked beyond the pools' caps go with them
+    Mesh::releasePending();
+    Mesh::pool().trim();
+    ChunkSection::pool().trim();
+    SectionLight::pool().trim();
+}
+
+void World::updateStreaming(float px, float pz) {
+    auto msSince = [](std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+    };
+    auto t0 = std::chrono::steady_clock::now();
+
+    // queue missing chunks ring by ring, nearest first; only rescan when the
+    // player changed chunk or now and then to pick up evicted/cancelled holes
+    int pcx = static_cast<int>(std::floor(px / CHUNK_SIZE));
+    int pcz = static_cast<int>(std::floor(pz / CHUNK_SIZE));
+    if (pcx != streamCenterX || pcz != streamCenterZ || ++streamRescanCountdown >= 30) {
+        streamCenterX = pcx;
+        streamCenterZ = pcz;
+        streamRescanCountdown = 0;
+        updateLod();
+        int radius = std::min(streamRadius, unloadRadius);
+        for (int r = 0; r <= radius; ++r) {
+            for (int dx = -r; dx <= r; ++dx) {
+                for (int dz = -r; dz <= r; ++dz) {
+                    if (std::max(std::abs(dx), std::abs(dz)) != r) continue;
+                    requestChunk(pcx + dx, pcz + dz);
+                }
+            }
         }
     }
 
-    for (Chunk* c : toRebuild) {
-        c->rebuildMesh(resourcePack);
-        ++rebuilt;
-        if (rebuilt >= maxRebuild) break;
+    processMeshQueue(meshUploadBudgetMs);
+    updateResidency(px, pz);
+
+    // reported through takeStreamingStats (the F3 overlay)
+    double total = msSince(t0);
+    streamStats.lastMs = total;
+    streamStats.worstMs = std::max(streamStats.worstMs, total);
+    if (total > spikeThresholdMs) ++streamStats.spikes;
+}
+
+World::StreamingStats World::takeStreamingStats() {
+    StreamingStats s = streamStats;
+    streamStats.worstMs = 0.0;
+    return s;
+}
+
+void World::updateResidency(float px, float pz) {
+    uint64_t tick = residencyTick.fetch_add(1, std::memory_order_relaxed) + 1;
+    // a full scan every frame is wasted work; chunks only drift out of range slowly
+    if (tick % 16 != 0) return;
+
+    int pcx = static_cast<int>(std::floor(px / CHUNK_SIZE));
+    int pcz = static_cast<int>(std::floor(pz / CHUNK_SIZE));
+    auto distOf = [&](const ChunkPtr& c) { return std::max(std::abs(c->x - pcx), std::abs(c->z - pcz)); };
+
+    // queued generation that is no longer wanted is dropped along with its reserved slot
+    // (queued meshing of evicted chunks finds them gone and does nothing)
+    auto dropped = jobs.cancelIf([&](const JobPool::Key& k) {
+        return k.kind == JobPool::GENERATE && std::max(std::abs(k.cx - pcx), std::abs(k.cz - pcz)) > unloadRadius;
+    });
+    for (const auto& k : dropped) chunks.erase(k.cx, k.cz);
+
+    std::vector<ChunkPtr> resident = chunks.snapshot();
+    std::vector<ChunkPtr> victims;
+    for (const ChunkPtr& c : resident)
+        if (distOf(c) > unloadRadius) victims.push_back(c);
+
+    // over the hard cap: also consider in-range chunks, except the ones around the player
+    size_t count = resident.size();
+    if (count - std::min(count, victims.size()) > maxResidentChunks) {
+        for (const ChunkPtr& c : resident)
+            if (distOf(c) <= unloadRadius && distOf(c) > 2) victims.push_back(c);
+    }
+
+    std::sort(victims.begin(), victims.end(), [](const ChunkPtr& a, const ChunkPtr& b) {
+        return a->lastUsed.load(std::memory_order_relaxed) < b->lastUsed.load(std::memory_order_relaxed);
+    });
+
+    int budget = maxEvictionsPerUpdate;
+    for (const ChunkPtr& c : victims) {
+        if (budget <= 0) break;
+        // out-of-range victims always go; in-range ones only while above the cap
+        if (distOf(c) <= unloadRadius && count <= maxResidentChunks) continue;
+        if (!evict(c)) continue;
+        --count;
+        --budget;
     }
 }
 
+bool World::evict(const ChunkPtr& c) {
+    // edits are written back first; if that fails the chunk stays resident
+    if (c->modified) {
+        if (!regions.save(*c)) return false;
+        c->modified = false;
+    }
+    // chunks still being generated only hold a reserved (null) slot and never get here
+    chunks.erase(c->x, c->z);
+    // faces of the chunks around it that were hidden by its border are visible again
+    remeshNeighbors(c->x, c->z);
+    // give the arena ranges back now, on the GL thread; the Mesh itself goes back to the pool
+    if (c->mesh) {
+        c->mesh->clear();
+        Mesh::pool().release(c->mesh);
+        c->mesh = nullptr;
+    }
+    ++evictedCount;
+    // block sections return to their pool once the last ChunkPtr holder lets go
+    return true;
+}
+
+void World::saveAll() {
+    chunks.forEach([&](const ChunkPtr& c) {
+        if (c->modified && regions.save(*c)) c->modified = false;
+    });
+}
+
 size_t World::getChunkCount() {
-    std::lock_guard<std::mutex> lk(chunksMutex);
     return chunks.size();
 }
 
 int World::getPendingMeshCount() {
     int count = 0;
-    std::lock_guard<std::mutex> lk(chunksMutex);
-    for (auto &p : chunks) {
-        Chunk* c = p.second;
-        if (c && c->needsMesh) ++count;
-    }
-    return count;
+    chunks.forEach([&](const ChunkPtr& c) {
+        if (c->needsMesh) ++count;
+    });
+    count += static_cast<int>(jobs.pending(JobPool::MESH));
+    std::lock_guard<std::mutex> lk(meshResultMutex);
+    return count + static_cast<int>(meshResults.size());
 }
@@ -1,20 +1,63 @@
 #pragma once
 #include "chunk.h"
-#include <unordered_map>
+#include "chunk_map.h"
+#include "region.h"
+#include "job_pool.h"
+#include "light.h"
+#include "mesh.h"
 #include <utility>
+#include <array>
 #include <cstdint>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 class World {
 public:
-    struct PairHash {
-        std::size_t operator()(const std::pair<int,int>& p) const noexcept {
-            uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(p.first)) << 32) |
-                           static_cast<uint32_t>(p.second);
-            return std::hash<uint64_t>{}(key);
-        }
+    // sharded, concurrently readable chunk index (see chunk_map.h)
+    ChunkMap chunks;
+
+    // streaming: chunks within streamRadius (in chunks) of the player are kept
+    // loaded, generated and meshed in the background; finished meshes are uploaded
+    // for up to meshUploadBudgetMs per frame. Streaming work on the main thread
+    // longer than spikeThresholdMs in a frame is reported as a spike
+    int streamRadius = 8;
+    double meshUploadBudgetMs = 2.0;
+    double spikeThresholdMs = 4.0;
+
+    struct StreamingStats {
+        double lastMs = 0.0;   // main-thread streaming time of the last frame
+        double worstMs = 0.0;  // worst frame since the last takeStreamingStats()
+        uint64_t spikes = 0;   // frames over spikeThresholdMs
     };
-    std::unordered_map<std::pair<int,int>, Chunk*, PairHash> chunks;
+
+    // height returned for columns whose chunk is not loaded yet
+    static constexpr int HEIGHT_UNKNOWN = -1000000;
+
+    // residency: chunks further than unloadRadius (in chunks) from the player are
+    // unloaded least recently used first; maxResidentChunks is a hard cap
+    int unloadRadius = 12;
+    size_t maxResidentChunks = 2048;
+    int maxEvictionsPerUpdate = 32;
+
+    // sky and block light; edits and the joins of newly published chunks with
+    // their neighbours are relit on the job pool
+    LightEngine light{chunks};
+
+    // on-disk chunk storage; generated chunks are only written once edited
+    RegionStore regions{"saves/world/region"};
+
+    // level of detail by distance: chunks further than lodRadius[i] (in chunks)
+    // from the player are meshed at level i + 1, blocks merged 2^(i + 1) to a side.
+    // A chunk only turns coarser once it is one chunk past the radius, so walking
+    // along a chunk border does not remesh a ring of chunks back and forth
+    std::array<int, Mesh::MAX_LOD> lodRadius = {5, 8, 12};
+
+    // mesher used for chunk meshes; NAIVE is the per-face reference. Change it
+    // with setMeshMode so loaded chunks are rebuilt with the new one. Mesh jobs
+    // read it when they run, so jobs still queued at a switch use the new one
+    std::atomic<MeshMode> meshMode{MeshMode::GREEDY};
 
     // optional resource pack pointer
     class ResourcePack* resourcePack = nullptr;
@@ -22,26 +65,85 @@ public:
     World();
     ~World();
 
-    Chunk* getChunk(int cx, int cz);
+    ChunkPtr getChunk(int cx, int cz) const;
+    // generate (or load) a chunk synchronously on the calling thread
     void generateChunk(int cx, int cz);
+    // queue a chunk for background generation on the job pool
+    void requestChunk(int cx, int cz);
+    // player position and view direction; queued generation runs nearest-first from here
+    void setViewer(float px, float pz, float dirX, float dirZ);
     void setBlockAt(int wx, int wy, int wz, Block block);
     Block getBlockAt(int wx, int wy, int wz) const;
 
-    // returns the surface y coordinate (top solid block) at world x,z coordinates
+    // returns the surface y coordinate (top solid block) at world x,z coordinates,
+    // or HEIGHT_UNKNOWN (and queues the chunk) if it is not loaded yet
     int getHeightAt(float wx, float wz);
 
     void setResourcePack(class ResourcePack* rp) { resourcePack = rp; }
+    // switch mesher and queue a full remesh of every loaded chunk (main thread)
+    void setMeshMode(MeshMode mode);
 
-    // pregenerate chunk block data in a background thread (no GL calls)
-    void pregenerateAsync(int radius);
+    // called on main thread: queues mesh builds for chunks that need one on the job
+    // pool and uploads finished meshes for up to budgetMs (at least one per call)
+    void processMeshQueue(double budgetMs);
 
-    // called on main thread to process queued mesh rebuilds (build up to maxRebuild meshes)
-    void processMeshQueue(int maxRebuild = 1);
+    // called on main thread once per frame: queues chunks around the player, builds
+    // queued meshes and unloads distant chunks; never generates on this thread
+    void updateStreaming(float px, float pz);
+    StreamingStats takeStreamingStats();
+
+    // unloads distant chunks and frees their meshes (part of updateStreaming)
+    void updateResidency(float px, float pz);
+    // write every edited chunk back to its region file
+    void saveAll();
+    // mark a chunk as just used for LRU ordering
+    void touch(Chunk& c) const { c.lastUsed.store(residencyTick.load(std::memory_order_relaxed), std::memory_order_relaxed); }
 
     // utilities for debugging
     size_t getChunkCount();
     int getPendingMeshCount();
+    size_t getEvictedCount() const { return evictedCount; }
+    size_t getPendingGenerationCount() const { return jobs.pending(JobPool::GENERATE); }
+    size_t getPendingLightCount() const { return light.pending(); }
 
 private:
-    std::mutex chunksMutex;
+    std::atomic<uint64_t> residencyTick{1};
+    size_t evictedCount = 0;
+
+    StreamingStats streamStats;
+    int streamCenterX = 0x7fffffff, streamCenterZ = 0x7fffffff;
+    int streamRescanCountdown = 0;
+
+    // CPU meshes finished on the pool, waiting for the GL thread to upload them
+    struct MeshResult {
+        std::weak_ptr<Chunk> chunk;
+        uint64_t revision = 0;  // Chunk::blockRevision the vertices were built from
+        uint64_t serial = 0;    // Chunk::meshSerial of the build
+        SharedSectionVertices sections;
+        SectionVersions versions{};
+        SectionQuadCounts cutoutQuads{};
+        SectionConnectivity connectivity{};
+    };
+    std::mutex meshResultMutex;
+    std::vector<MeshResult> meshResults;
+
+    // set while a light job is queued, so a burst of published chunks queues only one
+    std::atomic<bool> lightScheduled{false};
+
+    bool evict(const ChunkPtr& c);
+    void submitMesh(const ChunkPtr& c);
+    // publish a finished chunk and remesh the loaded chunks around it, whose
+    // border faces against it are now hidden
+    void publishChunk(int cx, int cz, ChunkPtr c);
+    void remeshNeighbors(int cx, int cz);
+    // level of detail for chunk c at the current stream center
+    int lodFor(const Chunk& c) const;
+    // re-pick every loaded chunk's level; changed chunks and their neighbours are remeshed
+    void updateLod();
+    // run the queued light updates on the pool, ahead of other jobs (cx,cz only keys the job)
+    void scheduleLight(int cx, int cz);
+    ChunkPtr loadOrGenerate(int cx, int cz);
+
+    // generator workers; declared last so they are destroyed before the chunks they touch
+    JobPool jobs;
 };
\ No newline at end of file